@@ -0,0 +1,957 @@
+/*
+ *   The Ultimate Ring Buffer v1.2 - Audio Kernels
+ *   �1999-2025 SUBBAND, Inc. & Dmitry Boldyrev
+ *   
+ *   Description:    SIMD sample kernels fused into AudioRing copies
+ *   Updated:        Oct 18, 2026
+ */
+
+#pragma once
+
+#include <type_traits>
+
+#include "ringbuffer.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#endif
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+// Packed little-endian 24-bit PCM sample (3 bytes, no padding)
+struct PackedInt24 {
+    uint8_t bytes[3];
+};
+static_assert(sizeof(PackedInt24) == 3, "PackedInt24 must be 3 bytes");
+
+// ===== SAMPLE FORMAT CONVERSION =====
+//
+// Every format is mapped to float [-1, 1) in registers and straight back out,
+// so each conversion is one pass over memory: load N samples of the source
+// format, scale (+ TPDF dither), saturate, store N samples of the target.
+// Integer targets always saturate at full scale; `clip` additionally clamps
+// float targets to [-1, 1]. Dither adds +-1 LSB triangular noise before
+// rounding to an integer target of 24 bits or less. Vector width is 8 lanes
+// with AVX2, 4 with SSE2 and AArch64 NEON; tails and formats without a vector path use
+// the scalar code, which produces identical results. int32 <-> double would
+// lose the low 8 bits in a float, so that pair takes a scalar double path.
+
+struct SampleConvertOptions {
+    bool clip{false};
+    bool dither{false};
+};
+
+// Per-lane xorshift32 state for TPDF dither; keep one per stream
+struct DitherState {
+    uint32_t lanes[8]{0x9E3779B9u, 0x7F4A7C15u, 0x85EBCA6Bu, 0xC2B2AE35u,
+                      0x27D4EB2Fu, 0x165667B1u, 0xD3A2646Cu, 0xFD7046C5u};
+};
+
+template <typename T> struct SampleTraits;
+template <> struct SampleTraits<int16_t> {
+    static constexpr bool kInteger = true;
+    static constexpr float kScale = 32768.0f;
+    static constexpr float kMax = 32767.0f;
+    static constexpr bool kDither = true;
+};
+template <> struct SampleTraits<PackedInt24> {
+    static constexpr bool kInteger = true;
+    static constexpr float kScale = 8388608.0f;
+    static constexpr float kMax = 8388607.0f;
+    static constexpr bool kDither = true;
+};
+template <> struct SampleTraits<int32_t> {
+    static constexpr bool kInteger = true;
+    static constexpr float kScale = 2147483648.0f;
+    static constexpr float kMax = 2147483520.0f;    // largest float below 2^31
+    static constexpr bool kDither = false;          // below float precision
+};
+template <> struct SampleTraits<float> {
+    static constexpr bool kInteger = false;
+    static constexpr float kScale = 1.0f;
+    static constexpr float kMax = 1.0f;
+    static constexpr bool kDither = false;
+};
+template <> struct SampleTraits<double> {
+    static constexpr bool kInteger = false;
+    static constexpr float kScale = 1.0f;
+    static constexpr float kMax = 1.0f;
+    static constexpr bool kDither = false;
+};
+
+struct AudioKernels {
+    // ===== SCALAR PATH =====
+    
+    static inline float LoadSample(const int16_t* p) { return (float)*p * (1.0f / 32768.0f); }
+    static inline float LoadSample(const int32_t* p) { return (float)*p * (1.0f / 2147483648.0f); }
+    static inline float LoadSample(const float* p) { return *p; }
+    static inline float LoadSample(const double* p) { return (float)*p; }
+    static inline float LoadSample(const PackedInt24* p) {
+        int32_t v = (int32_t)((uint32_t)p->bytes[0] << 8 | (uint32_t)p->bytes[1] << 16 | (uint32_t)p->bytes[2] << 24);
+        return (float)v * (1.0f / 2147483648.0f);
+    }
+    
+    static inline uint32_t NextRandom(uint32_t& s) {
+        s ^= s << 13;
+        s ^= s >> 17;
+        s ^= s << 5;
+        return s;
+    }
+    
+    // Uniform [0, 1) from the top 23 bits
+    static inline float RandomUnit(uint32_t& s) {
+        uint32_t bits = (NextRandom(s) >> 9) | 0x3F800000u;
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        return f - 1.0f;
+    }
+    
+    template <typename DstT>
+    static inline void StoreSample(DstT* p, float v, const SampleConvertOptions& opt, uint32_t& seed) {
+        using Traits = SampleTraits<DstT>;
+        if constexpr (Traits::kInteger) {
+            float x = v * Traits::kScale;
+            if (Traits::kDither && opt.dither) {
+                x += RandomUnit(seed) - RandomUnit(seed);
+            }
+            x = std::min(std::max(x, -Traits::kScale), Traits::kMax);
+            int32_t i = (int32_t)std::lrintf(x);
+            if constexpr (std::is_same<DstT, PackedInt24>::value) {
+                p->bytes[0] = (uint8_t)i;
+                p->bytes[1] = (uint8_t)(i >> 8);
+                p->bytes[2] = (uint8_t)(i >> 16);
+            } else {
+                *p = (DstT)i;
+            }
+        } else {
+            if (opt.clip) v = std::min(std::max(v, -1.0f), 1.0f);
+            *p = (DstT)v;
+        }
+    }
+    
+    // Full-precision int32 <-> double; float only carries 24 bits
+    static inline double LoadSampleWide(const int32_t* p) { return (double)*p * (1.0 / 2147483648.0); }
+    static inline double LoadSampleWide(const double* p) { return *p; }
+    
+    static inline void StoreSampleWide(int32_t* p, double v, const SampleConvertOptions&) {
+        double x = std::min(std::max(v * 2147483648.0, -2147483648.0), 2147483647.0);
+        *p = (int32_t)std::llrint(x);
+    }
+    static inline void StoreSampleWide(double* p, double v, const SampleConvertOptions& opt) {
+        if (opt.clip) v = std::min(std::max(v, -1.0), 1.0);
+        *p = v;
+    }
+    
+    // ===== VECTOR PATH =====
+    
+#if defined(__AVX2__)
+    static constexpr int kLanes = 8;
+    using VecF = __m256;
+    using VecI = __m256i;
+    
+    static inline VecF Load(const float* p) { return _mm256_loadu_ps(p); }
+    static inline VecF Load(const double* p) {
+        return _mm256_set_m128(_mm256_cvtpd_ps(_mm256_loadu_pd(p + 4)), _mm256_cvtpd_ps(_mm256_loadu_pd(p)));
+    }
+    static inline VecF Load(const int16_t* p) {
+        __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        return _mm256_mul_ps(_mm256_cvtepi32_ps(v), _mm256_set1_ps(1.0f / 32768.0f));
+    }
+    static inline VecF Load(const int32_t* p) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        return _mm256_mul_ps(_mm256_cvtepi32_ps(v), _mm256_set1_ps(1.0f / 2147483648.0f));
+    }
+    static inline VecF Load(const PackedInt24* p) {
+        // 24 bytes = two overlapping 16-byte loads, each expanded to 4 lanes of (sample << 8)
+        const uint8_t* b = p->bytes;
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + 8));
+        lo = _mm_shuffle_epi8(lo, _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11));
+        hi = _mm_shuffle_epi8(hi, _mm_setr_epi8(-1, 4, 5, 6, -1, 7, 8, 9, -1, 10, 11, 12, -1, 13, 14, 15));
+        __m256i v = _mm256_set_m128i(hi, lo);
+        return _mm256_mul_ps(_mm256_cvtepi32_ps(v), _mm256_set1_ps(1.0f / 2147483648.0f));
+    }
+    
+    static inline VecI LoadSeed(const DitherState& d) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(d.lanes)); }
+    static inline void StoreSeed(DitherState& d, VecI s) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(d.lanes), s); }
+    
+    static inline VecF RandomUnit(VecI& s) {
+        s = _mm256_xor_si256(s, _mm256_slli_epi32(s, 13));
+        s = _mm256_xor_si256(s, _mm256_srli_epi32(s, 17));
+        s = _mm256_xor_si256(s, _mm256_slli_epi32(s, 5));
+        __m256i bits = _mm256_or_si256(_mm256_srli_epi32(s, 9), _mm256_set1_epi32(0x3F800000));
+        return _mm256_sub_ps(_mm256_castsi256_ps(bits), _mm256_set1_ps(1.0f));
+    }
+    
+    template <typename DstT>
+    static inline VecI ToInt(VecF v, const SampleConvertOptions& opt, VecI& seed) {
+        using Traits = SampleTraits<DstT>;
+        VecF x = _mm256_mul_ps(v, _mm256_set1_ps(Traits::kScale));
+        if (Traits::kDither && opt.dither) {
+            VecF a = RandomUnit(seed);
+            x = _mm256_add_ps(x, _mm256_sub_ps(a, RandomUnit(seed)));
+        }
+        x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-Traits::kScale)), _mm256_set1_ps(Traits::kMax));
+        return _mm256_cvtps_epi32(x);
+    }
+    
+    static inline void Store(float* p, VecF v, const SampleConvertOptions& opt, VecI&) {
+        if (opt.clip) v = _mm256_min_ps(_mm256_max_ps(v, _mm256_set1_ps(-1.0f)), _mm256_set1_ps(1.0f));
+        _mm256_storeu_ps(p, v);
+    }
+    static inline void Store(double* p, VecF v, const SampleConvertOptions& opt, VecI&) {
+        if (opt.clip) v = _mm256_min_ps(_mm256_max_ps(v, _mm256_set1_ps(-1.0f)), _mm256_set1_ps(1.0f));
+        _mm256_storeu_pd(p, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+        _mm256_storeu_pd(p + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+    }
+    static inline void Store(int16_t* p, VecF v, const SampleConvertOptions& opt, VecI& seed) {
+        __m256i i = ToInt<int16_t>(v, opt, seed);
+        __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(i), _mm256_extracti128_si256(i, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), packed);
+    }
+    static inline void Store(int32_t* p, VecF v, const SampleConvertOptions& opt, VecI& seed) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), ToInt<int32_t>(v, opt, seed));
+    }
+    static inline void Store(PackedInt24* p, VecF v, const SampleConvertOptions& opt, VecI& seed) {
+        __m256i i = ToInt<PackedInt24>(v, opt, seed);
+        const __m128i pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+        alignas(16) uint8_t tmp[32];
+        _mm_store_si128(reinterpret_cast<__m128i*>(tmp), _mm_shuffle_epi8(_mm256_castsi256_si128(i), pack));
+        _mm_store_si128(reinterpret_cast<__m128i*>(tmp + 16), _mm_shuffle_epi8(_mm256_extracti128_si256(i, 1), pack));
+        std::memcpy(p->bytes, tmp, 12);
+        std::memcpy(p->bytes + 12, tmp + 16, 12);
+    }
+    
+    template <typename T> static constexpr bool kVector = true;
+#elif defined(__SSE2__) || defined(_M_X64)
+    static constexpr int kLanes = 4;
+    using VecF = __m128;
+    using VecI = __m128i;
+    
+    static inline VecF Load(const float* p) { return _mm_loadu_ps(p); }
+    static inline VecF Load(const double* p) {
+        return _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(p)), _mm_cvtpd_ps(_mm_loadu_pd(p + 2)));
+    }
+    static inline VecF Load(const int16_t* p) {
+        __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+        v = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        return _mm_mul_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(1.0f / 32768.0f));
+    }
+    static inline VecF Load(const int32_t* p) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        return _mm_mul_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(1.0f / 2147483648.0f));
+    }
+#if defined(__SSSE3__)
+    static inline VecF Load(const PackedInt24* p) {
+        // Copy the 12 bytes of four samples into a zeroed 16-byte scratch so
+        // nothing past the run is read; the shuffle ignores bytes 12-15
+        uint8_t tmp[16] = {};
+        std::memcpy(tmp, p->bytes, 12);
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tmp));
+        v = _mm_shuffle_epi8(v, _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11));
+        return _mm_mul_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(1.0f / 2147483648.0f));
+    }
+#endif
+    
+    static inline VecI LoadSeed(const DitherState& d) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(d.lanes)); }
+    static inline void StoreSeed(DitherState& d, VecI s) { _mm_storeu_si128(reinterpret_cast<__m128i*>(d.lanes), s); }
+    
+    static inline VecF RandomUnit(VecI& s) {
+        s = _mm_xor_si128(s, _mm_slli_epi32(s, 13));
+        s = _mm_xor_si128(s, _mm_srli_epi32(s, 17));
+        s = _mm_xor_si128(s, _mm_slli_epi32(s, 5));
+        __m128i bits = _mm_or_si128(_mm_srli_epi32(s, 9), _mm_set1_epi32(0x3F800000));
+        return _mm_sub_ps(_mm_castsi128_ps(bits), _mm_set1_ps(1.0f));
+    }
+    
+    template <typename DstT>
+    static inline VecI ToInt(VecF v, const SampleConvertOptions& opt, VecI& seed) {
+        using Traits = SampleTraits<DstT>;
+        VecF x = _mm_mul_ps(v, _mm_set1_ps(Traits::kScale));
+        if (Traits::kDither && opt.dither) {
+            VecF a = RandomUnit(seed);
+            x = _mm_add_ps(x, _mm_sub_ps(a, RandomUnit(seed)));
+        }
+        x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-Traits::kScale)), _mm_set1_ps(Traits::kMax));
+        return _mm_cvtps_epi32(x);
+    }
+    
+    static inline void Store(float* p, VecF v, const SampleConvertOptions& opt, VecI&) {
+        if (opt.clip) v = _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+        _mm_storeu_ps(p, v);
+    }
+    static inline void Store(double* p, VecF v, const SampleConvertOptions& opt, VecI&) {
+        if (opt.clip) v = _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+        _mm_storeu_pd(p, _mm_cvtps_pd(v));
+        _mm_storeu_pd(p + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+    }
+    static inline void Store(int16_t* p, VecF v, const SampleConvertOptions& opt, VecI& seed) {
+        __m128i i = ToInt<int16_t>(v, opt, seed);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packs_epi32(i, i));
+    }
+    static inline void Store(int32_t* p, VecF v, const SampleConvertOptions& opt, VecI& seed) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), ToInt<int32_t>(v, opt, seed));
+    }
+#if defined(__SSSE3__)
+    static inline void Store(PackedInt24* p, VecF v, const SampleConvertOptions& opt, VecI& seed) {
+        __m128i i = ToInt<PackedInt24>(v, opt, seed);
+        alignas(16) uint8_t tmp[16];
+        _mm_store_si128(reinterpret_cast<__m128i*>(tmp),
+                        _mm_shuffle_epi8(i, _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1)));
+        std::memcpy(p->bytes, tmp, 12);
+    }
+    template <typename T> static constexpr bool kVector = true;
+#else
+    template <typename T> static constexpr bool kVector = !std::is_same<T, PackedInt24>::value;
+#endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    static constexpr int kLanes = 4;
+    using VecF = float32x4_t;
+    using VecI = uint32x4_t;
+    
+    static inline VecF Load(const float* p) { return vld1q_f32(p); }
+    static inline VecF Load(const double* p) {
+        return vcombine_f32(vcvt_f32_f64(vld1q_f64(p)), vcvt_f32_f64(vld1q_f64(p + 2)));
+    }
+    static inline VecF Load(const int16_t* p) {
+        return vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vld1_s16(p))), 1.0f / 32768.0f);
+    }
+    static inline VecF Load(const int32_t* p) {
+        return vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(p)), 1.0f / 2147483648.0f);
+    }
+    
+    static inline VecI LoadSeed(const DitherState& d) { return vld1q_u32(d.lanes); }
+    static inline void StoreSeed(DitherState& d, VecI s) { vst1q_u32(d.lanes, s); }
+    
+    static inline VecF RandomUnit(VecI& s) {
+        s = veorq_u32(s, vshlq_n_u32(s, 13));
+        s = veorq_u32(s, vshrq_n_u32(s, 17));
+        s = veorq_u32(s, vshlq_n_u32(s, 5));
+        uint32x4_t bits = vorrq_u32(vshrq_n_u32(s, 9), vdupq_n_u32(0x3F800000u));
+        return vsubq_f32(vreinterpretq_f32_u32(bits), vdupq_n_f32(1.0f));
+    }
+    
+    template <typename DstT>
+    static inline int32x4_t ToInt(VecF v, const SampleConvertOptions& opt, VecI& seed) {
+        using Traits = SampleTraits<DstT>;
+        VecF x = vmulq_n_f32(v, Traits::kScale);
+        if (Traits::kDither && opt.dither) {
+            VecF a = RandomUnit(seed);
+            x = vaddq_f32(x, vsubq_f32(a, RandomUnit(seed)));
+        }
+        x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(-Traits::kScale)), vdupq_n_f32(Traits::kMax));
+        return vcvtnq_s32_f32(x);
+    }
+    
+    static inline void Store(float* p, VecF v, const SampleConvertOptions& opt, VecI&) {
+        if (opt.clip) v = vminq_f32(vmaxq_f32(v, vdupq_n_f32(-1.0f)), vdupq_n_f32(1.0f));
+        vst1q_f32(p, v);
+    }
+    static inline void Store(double* p, VecF v, const SampleConvertOptions& opt, VecI&) {
+        if (opt.clip) v = vminq_f32(vmaxq_f32(v, vdupq_n_f32(-1.0f)), vdupq_n_f32(1.0f));
+        vst1q_f64(p, vcvt_f64_f32(vget_low_f32(v)));
+        vst1q_f64(p + 2, vcvt_high_f64_f32(v));
+    }
+    static inline void Store(int16_t* p, VecF v, const SampleConvertOptions& opt, VecI& seed) {
+        vst1_s16(p, vqmovn_s32(ToInt<int16_t>(v, opt, seed)));
+    }
+    static inline void Store(int32_t* p, VecF v, const SampleConvertOptions& opt, VecI& seed) {
+        vst1q_s32(p, ToInt<int32_t>(v, opt, seed));
+    }
+    
+    template <typename T> static constexpr bool kVector = !std::is_same<T, PackedInt24>::value;
+#else
+    static constexpr int kLanes = 1;
+    using VecI = uint32_t;
+    static inline VecI LoadSeed(const DitherState& d) { return d.lanes[0]; }
+    static inline void StoreSeed(DitherState& d, VecI s) { d.lanes[0] = s; }
+    template <typename T> static constexpr bool kVector = false;
+#endif
+    
+    // ===== CONVERSION LOOP =====
+    
+    template <typename SrcT, typename DstT>
+    static inline void Convert(DstT* _Nonnull dst, const SrcT* _Nonnull src, size_t samples,
+                               const SampleConvertOptions& opt, DitherState& dither) {
+        if constexpr (std::is_same<SrcT, DstT>::value) {
+            std::memcpy(dst, src, samples * sizeof(SrcT));
+            if constexpr (!SampleTraits<DstT>::kInteger) {
+                if (opt.clip) {
+                    for (size_t i = 0; i < samples; i++) dst[i] = std::min(std::max(dst[i], (DstT)-1), (DstT)1);
+                }
+            }
+            return;
+        } else if constexpr ((std::is_same<SrcT, int32_t>::value && std::is_same<DstT, double>::value) ||
+                             (std::is_same<SrcT, double>::value && std::is_same<DstT, int32_t>::value)) {
+            for (size_t i = 0; i < samples; i++) {
+                StoreSampleWide(dst + i, LoadSampleWide(src + i), opt);
+            }
+            return;
+        }
+        
+        size_t i = 0;
+        if constexpr (kLanes > 1 && kVector<SrcT> && kVector<DstT>) {
+            VecI seed = LoadSeed(dither);
+            for (; i + kLanes <= samples; i += kLanes) {
+                Store(dst + i, Load(src + i), opt, seed);
+            }
+            StoreSeed(dither, seed);
+        }
+        for (; i < samples; i++) {
+            StoreSample(dst + i, LoadSample(src + i), opt, dither.lanes[i & 7]);
+        }
+    }
+    
+    // ===== WEIGHTED FRAME ACCUMULATION =====
+    //
+    // out[c] (+)= w * in[c] across one frame of channels; the building block
+    // of interpolated and multi-tap reads, vectorised across channels.
+    
+    static inline void ScaleFrame(float* _Nonnull out, const float* _Nonnull in, float w, int channels) {
+        int c = 0;
+#if defined(__AVX2__)
+        __m256 w8 = _mm256_set1_ps(w);
+        for (; c + 8 <= channels; c += 8) {
+            _mm256_storeu_ps(out + c, _mm256_mul_ps(_mm256_loadu_ps(in + c), w8));
+        }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+        __m128 w4 = _mm_set1_ps(w);
+        for (; c + 4 <= channels; c += 4) {
+            _mm_storeu_ps(out + c, _mm_mul_ps(_mm_loadu_ps(in + c), w4));
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        for (; c + 4 <= channels; c += 4) {
+            vst1q_f32(out + c, vmulq_n_f32(vld1q_f32(in + c), w));
+        }
+#endif
+        for (; c < channels; c++) {
+            out[c] = in[c] * w;
+        }
+    }
+    
+    static inline void AccumulateFrame(float* _Nonnull out, const float* _Nonnull in, float w, int channels) {
+        int c = 0;
+#if defined(__AVX2__)
+        __m256 w8 = _mm256_set1_ps(w);
+        for (; c + 8 <= channels; c += 8) {
+#if defined(__FMA__)
+            _mm256_storeu_ps(out + c, _mm256_fmadd_ps(_mm256_loadu_ps(in + c), w8, _mm256_loadu_ps(out + c)));
+#else
+            _mm256_storeu_ps(out + c, _mm256_add_ps(_mm256_loadu_ps(out + c), _mm256_mul_ps(_mm256_loadu_ps(in + c), w8)));
+#endif
+        }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+        __m128 w4 = _mm_set1_ps(w);
+        for (; c + 4 <= channels; c += 4) {
+            _mm_storeu_ps(out + c, _mm_add_ps(_mm_loadu_ps(out + c), _mm_mul_ps(_mm_loadu_ps(in + c), w4)));
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        for (; c + 4 <= channels; c += 4) {
+            vst1q_f32(out + c, vfmaq_n_f32(vld1q_f32(out + c), vld1q_f32(in + c), w));
+        }
+#endif
+        for (; c < channels; c++) {
+            out[c] += in[c] * w;
+        }
+    }
+    
+    // In-place linear gain ramp across interleaved frames: frame f is
+    // scaled by start + step * f. Vectorised over the flattened samples
+    // when a register holds whole frames (channels dividing the lane count).
+    template <typename T>
+    static inline void ApplyRamp(T* _Nonnull data, int channels, int frames, float start, float step) {
+        size_t i = 0;
+        size_t total = (size_t)frames * channels;
+        if constexpr (std::is_same_v<T, float>) {
+#if defined(__AVX2__)
+            if (8 % channels == 0) {
+                __m256 index = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+                index = _mm256_floor_ps(_mm256_div_ps(index, _mm256_set1_ps((float)channels)));
+                __m256 next = _mm256_set1_ps((float)(8 / channels));
+                for (; i + 8 <= total; i += 8) {
+                    __m256 gain = _mm256_add_ps(_mm256_set1_ps(start), _mm256_mul_ps(index, _mm256_set1_ps(step)));
+                    _mm256_storeu_ps(data + i, _mm256_mul_ps(_mm256_loadu_ps(data + i), gain));
+                    index = _mm256_add_ps(index, next);
+                }
+            }
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(__ARM_NEON) && defined(__aarch64__))
+            if (4 % channels == 0) {
+                alignas(16) float lanes[4];
+                for (int k = 0; k < 4; k++) {
+                    lanes[k] = (float)((i + k) / channels);
+                }
+                float next = (float)(4 / channels);
+#if defined(__SSE2__) || defined(_M_X64)
+                __m128 index = _mm_load_ps(lanes);
+                for (; i + 4 <= total; i += 4) {
+                    __m128 gain = _mm_add_ps(_mm_set1_ps(start), _mm_mul_ps(index, _mm_set1_ps(step)));
+                    _mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), gain));
+                    index = _mm_add_ps(index, _mm_set1_ps(next));
+                }
+#else
+                float32x4_t index = vld1q_f32(lanes);
+                for (; i + 4 <= total; i += 4) {
+                    float32x4_t gain = vfmaq_n_f32(vdupq_n_f32(start), index, step);
+                    vst1q_f32(data + i, vmulq_f32(vld1q_f32(data + i), gain));
+                    index = vaddq_f32(index, vdupq_n_f32(next));
+                }
+#endif
+            } else {
+                // Odd channel counts: whole frames at a time, vectorised across channels
+                for (int f = (int)(i / channels); f < frames; f++) {
+                    float* frame = data + (size_t)f * channels;
+                    ScaleFrame(frame, frame, start + step * (float)f, channels);
+                }
+                return;
+            }
+#endif
+        }
+        for (; i < total; i++) {
+            data[i] = (T)(data[i] * (start + step * (float)(i / channels)));
+        }
+    }
+    
+    // out[i] = a[i] * b[i] (window application)
+    static inline void Multiply(float* _Nonnull out, const float* _Nonnull a, const float* _Nonnull b, int n) {
+        int i = 0;
+#if defined(__AVX2__)
+        for (; i + 8 <= n; i += 8) {
+            _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+        for (; i + 4 <= n; i += 4) {
+            _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        for (; i + 4 <= n; i += 4) {
+            vst1q_f32(out + i, vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+        }
+#endif
+        for (; i < n; i++) {
+            out[i] = a[i] * b[i];
+        }
+    }
+    
+    // out[i] += a[i] * b[i] (windowed overlap-add)
+    static inline void MultiplyAccumulate(float* _Nonnull out, const float* _Nonnull a, const float* _Nonnull b, int n) {
+        int i = 0;
+#if defined(__AVX2__)
+        for (; i + 8 <= n; i += 8) {
+#if defined(__FMA__)
+            _mm256_storeu_ps(out + i, _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), _mm256_loadu_ps(out + i)));
+#else
+            _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(out + i), _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i))));
+#endif
+        }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+        for (; i + 4 <= n; i += 4) {
+            _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i))));
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        for (; i + 4 <= n; i += 4) {
+            vst1q_f32(out + i, vfmaq_f32(vld1q_f32(out + i), vld1q_f32(a + i), vld1q_f32(b + i)));
+        }
+#endif
+        for (; i < n; i++) {
+            out[i] += a[i] * b[i];
+        }
+    }
+    
+    // Inner product of two float arrays (polyphase FIR taps)
+    static inline float Dot(const float* _Nonnull a, const float* _Nonnull b, int n) {
+        int i = 0;
+        float sum = 0.0f;
+#if defined(__AVX2__)
+        __m256 acc8 = _mm256_setzero_ps();
+        for (; i + 8 <= n; i += 8) {
+#if defined(__FMA__)
+            acc8 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc8);
+#else
+            acc8 = _mm256_add_ps(acc8, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+#endif
+        }
+        __m128 acc = _mm_add_ps(_mm256_castps256_ps128(acc8), _mm256_extractf128_ps(acc8, 1));
+#elif defined(__SSE2__) || defined(_M_X64)
+        __m128 acc = _mm_setzero_ps();
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+        for (; i + 4 <= n; i += 4) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        }
+        acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+        acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+        sum = _mm_cvtss_f32(acc);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        float32x4_t acc = vdupq_n_f32(0.0f);
+        for (; i + 4 <= n; i += 4) {
+            acc = vfmaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+        }
+        sum = vaddvq_f32(acc);
+#endif
+        for (; i < n; i++) {
+            sum += a[i] * b[i];
+        }
+        return sum;
+    }
+    
+    // ===== FUSED WRITE ANALYSIS =====
+    //
+    // Copies n samples (dst may be null to analyse only) and returns the
+    // peak |x|, adding to `clipped` every sample with |x| >= clipLevel.
+    // Integer formats are measured normalised, as LoadSample() reads them,
+    // and the clip level is capped at the format's positive full scale
+    // (32767 / 32768 for int16_t) so both rails count as clipped.
+    
+    // Set bits in an 8-bit movemask result
+    static inline uint32_t MaskBits(int mask) {
+        uint32_t m = (uint32_t)mask;
+        m = m - ((m >> 1) & 0x55);
+        m = (m & 0x33) + ((m >> 2) & 0x33);
+        return (m + (m >> 4)) & 0x0F;
+    }
+    
+    template <typename T>
+    static inline float CopyAnalyze(T* _Nullable dst, const T* _Nonnull src, size_t n, float clipLevel, uint32_t& clipped) {
+        size_t i = 0;
+        float peak = 0.0f;
+        if constexpr (SampleTraits<T>::kInteger) {
+            clipLevel = std::min(clipLevel, SampleTraits<T>::kMax / SampleTraits<T>::kScale);
+        }
+        if constexpr (std::is_same_v<T, float>) {
+#if defined(__AVX2__)
+            __m256 sign = _mm256_set1_ps(-0.0f);
+            __m256 clip = _mm256_set1_ps(clipLevel);
+            __m256 peak8 = _mm256_setzero_ps();
+            for (; i + 8 <= n; i += 8) {
+                __m256 x = _mm256_loadu_ps(src + i);
+                if (dst) _mm256_storeu_ps(dst + i, x);
+                __m256 magnitude = _mm256_andnot_ps(sign, x);
+                peak8 = _mm256_max_ps(peak8, magnitude);
+                clipped += MaskBits(_mm256_movemask_ps(_mm256_cmp_ps(magnitude, clip, _CMP_GE_OQ)));
+            }
+            __m128 peak4 = _mm_max_ps(_mm256_castps256_ps128(peak8), _mm256_extractf128_ps(peak8, 1));
+            peak4 = _mm_max_ps(peak4, _mm_movehl_ps(peak4, peak4));
+            peak4 = _mm_max_ss(peak4, _mm_shuffle_ps(peak4, peak4, 1));
+            peak = _mm_cvtss_f32(peak4);
+#elif defined(__SSE2__) || defined(_M_X64)
+            __m128 sign = _mm_set1_ps(-0.0f);
+            __m128 clip = _mm_set1_ps(clipLevel);
+            __m128 peak4 = _mm_setzero_ps();
+            for (; i + 4 <= n; i += 4) {
+                __m128 x = _mm_loadu_ps(src + i);
+                if (dst) _mm_storeu_ps(dst + i, x);
+                __m128 magnitude = _mm_andnot_ps(sign, x);
+                peak4 = _mm_max_ps(peak4, magnitude);
+                clipped += MaskBits(_mm_movemask_ps(_mm_cmpge_ps(magnitude, clip)));
+            }
+            peak4 = _mm_max_ps(peak4, _mm_movehl_ps(peak4, peak4));
+            peak4 = _mm_max_ss(peak4, _mm_shuffle_ps(peak4, peak4, 1));
+            peak = _mm_cvtss_f32(peak4);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+            float32x4_t clip = vdupq_n_f32(clipLevel);
+            float32x4_t peak4 = vdupq_n_f32(0.0f);
+            uint32x4_t count4 = vdupq_n_u32(0);
+            for (; i + 4 <= n; i += 4) {
+                float32x4_t x = vld1q_f32(src + i);
+                if (dst) vst1q_f32(dst + i, x);
+                float32x4_t magnitude = vabsq_f32(x);
+                peak4 = vmaxq_f32(peak4, magnitude);
+                count4 = vsubq_u32(count4, vcgeq_f32(magnitude, clip));     // true lanes are all-ones (-1)
+            }
+            peak = vmaxvq_f32(peak4);
+            clipped += vaddvq_u32(count4);
+#endif
+        }
+        for (; i < n; i++) {
+            if (dst) dst[i] = src[i];
+            float magnitude = std::fabs(LoadSample(src + i));
+            peak = std::max(peak, magnitude);
+            clipped += magnitude >= clipLevel;
+        }
+        return peak;
+    }
+    
+    // ===== MIX MATRIX =====
+    //
+    // out[f][o] = sum_i in[f][i] * g[o][i], interleaved on both sides, with
+    // the row-major outChannels x inChannels matrix ramping linearly: frame
+    // f uses start + delta * (rampIndex + f + 1). The AVX2 path gathers
+    // eight frames of each input channel and accumulates up to eight output
+    // channels in registers, so every gain is one FMA per eight frames.
+    // SSE2 and AArch64 NEON do the same four frames at a time.
+    
+    static inline void MixFrames(float* _Nonnull out, int outChannels, const float* _Nonnull in, int inChannels,
+                                 int frames, const float* _Nonnull start, const float* _Nonnull delta, int rampIndex) {
+        int f = 0;
+#if defined(__AVX2__)
+        constexpr int kGroup = 8;
+        __m256i stride = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(inChannels));
+        __m256 lane = _mm256_setr_ps(1, 2, 3, 4, 5, 6, 7, 8);
+        alignas(32) float mixed[kGroup][8];
+        
+        for (; f + 8 <= frames; f += 8) {
+            const float* src = in + (size_t)f * inChannels;
+            __m256 position = _mm256_add_ps(lane, _mm256_set1_ps((float)(rampIndex + f)));
+            
+            for (int group = 0; group < outChannels; group += kGroup) {
+                int count = std::min(kGroup, outChannels - group);
+                __m256 acc[kGroup];
+                for (int o = 0; o < count; o++) acc[o] = _mm256_setzero_ps();
+                
+                for (int i = 0; i < inChannels; i++) {
+                    __m256 x = _mm256_i32gather_ps(src + i, stride, 4);
+                    for (int o = 0; o < count; o++) {
+                        size_t g = (size_t)(group + o) * inChannels + i;
+                        __m256 gain = _mm256_add_ps(_mm256_set1_ps(start[g]), _mm256_mul_ps(position, _mm256_set1_ps(delta[g])));
+#if defined(__FMA__)
+                        acc[o] = _mm256_fmadd_ps(x, gain, acc[o]);
+#else
+                        acc[o] = _mm256_add_ps(acc[o], _mm256_mul_ps(x, gain));
+#endif
+                    }
+                }
+                
+                for (int o = 0; o < count; o++) _mm256_store_ps(mixed[o], acc[o]);
+                float* dst = out + (size_t)f * outChannels + group;
+                for (int k = 0; k < 8; k++) {
+                    for (int o = 0; o < count; o++) {
+                        dst[(size_t)k * outChannels + o] = mixed[o][k];
+                    }
+                }
+            }
+        }
+#elif defined(__SSE2__) || defined(_M_X64)
+        // Same scheme four frames wide; no gather, so lanes are set per input channel
+        constexpr int kGroup = 8;
+        __m128 lane = _mm_setr_ps(1, 2, 3, 4);
+        alignas(16) float mixed[kGroup][4];
+        
+        for (; f + 4 <= frames; f += 4) {
+            const float* src = in + (size_t)f * inChannels;
+            __m128 position = _mm_add_ps(lane, _mm_set1_ps((float)(rampIndex + f)));
+            
+            for (int group = 0; group < outChannels; group += kGroup) {
+                int count = std::min(kGroup, outChannels - group);
+                __m128 acc[kGroup];
+                for (int o = 0; o < count; o++) acc[o] = _mm_setzero_ps();
+                
+                for (int i = 0; i < inChannels; i++) {
+                    __m128 x = _mm_setr_ps(src[i], src[inChannels + i], src[2 * inChannels + i], src[3 * inChannels + i]);
+                    for (int o = 0; o < count; o++) {
+                        size_t g = (size_t)(group + o) * inChannels + i;
+                        __m128 gain = _mm_add_ps(_mm_set1_ps(start[g]), _mm_mul_ps(position, _mm_set1_ps(delta[g])));
+                        acc[o] = _mm_add_ps(acc[o], _mm_mul_ps(x, gain));
+                    }
+                }
+                
+                for (int o = 0; o < count; o++) _mm_store_ps(mixed[o], acc[o]);
+                float* dst = out + (size_t)f * outChannels + group;
+                for (int k = 0; k < 4; k++) {
+                    for (int o = 0; o < count; o++) {
+                        dst[(size_t)k * outChannels + o] = mixed[o][k];
+                    }
+                }
+            }
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        constexpr int kGroup = 8;
+        const float lanes[4] = {1, 2, 3, 4};
+        float32x4_t lane = vld1q_f32(lanes);
+        alignas(16) float mixed[kGroup][4];
+        
+        for (; f + 4 <= frames; f += 4) {
+            const float* src = in + (size_t)f * inChannels;
+            float32x4_t position = vaddq_f32(lane, vdupq_n_f32((float)(rampIndex + f)));
+            
+            for (int group = 0; group < outChannels; group += kGroup) {
+                int count = std::min(kGroup, outChannels - group);
+                float32x4_t acc[kGroup];
+                for (int o = 0; o < count; o++) acc[o] = vdupq_n_f32(0.0f);
+                
+                for (int i = 0; i < inChannels; i++) {
+                    const float column[4] = {src[i], src[inChannels + i], src[2 * inChannels + i], src[3 * inChannels + i]};
+                    float32x4_t x = vld1q_f32(column);
+                    for (int o = 0; o < count; o++) {
+                        size_t g = (size_t)(group + o) * inChannels + i;
+                        float32x4_t gain = vfmaq_n_f32(vdupq_n_f32(start[g]), position, delta[g]);
+                        acc[o] = vfmaq_f32(acc[o], x, gain);
+                    }
+                }
+                
+                for (int o = 0; o < count; o++) vst1q_f32(mixed[o], acc[o]);
+                float* dst = out + (size_t)f * outChannels + group;
+                for (int k = 0; k < 4; k++) {
+                    for (int o = 0; o < count; o++) {
+                        dst[(size_t)k * outChannels + o] = mixed[o][k];
+                    }
+                }
+            }
+        }
+#endif
+        for (; f < frames; f++) {
+            const float* src = in + (size_t)f * inChannels;
+            float* dst = out + (size_t)f * outChannels;
+            float position = (float)(rampIndex + f + 1);
+            for (int o = 0; o < outChannels; o++) {
+                const float* g0 = start + (size_t)o * inChannels;
+                const float* dg = delta + (size_t)o * inChannels;
+                float sum = 0.0f;
+                for (int i = 0; i < inChannels; i++) {
+                    sum += src[i] * (g0[i] + dg[i] * position);
+                }
+                dst[o] = sum;
+            }
+        }
+    }
+    
+    // ===== INTERLEAVE / DEINTERLEAVE =====
+    //
+    // Transpose between interleaved frames and per-channel (planar) arrays.
+    // `planarOffset` is the frame index inside each planar array, so a copy
+    // split at the ring's wrap point continues where the first run ended.
+    // Float data uses a stereo shuffle or 4x4 register transposes across
+    // groups of four channels; leftover channels and other types are scalar.
+    
+    template <typename T>
+    static inline void Deinterleave(T* _Nonnull const* _Nonnull planar, size_t planarOffset,
+                                    const T* _Nonnull src, int channels, int frames) {
+        int f = 0;
+        int c = 0;
+        if constexpr (std::is_same<T, float>::value) {
+#if defined(__SSE2__) || defined(_M_X64)
+            if (channels == 2) {
+                float* left = planar[0] + planarOffset;
+                float* right = planar[1] + planarOffset;
+                for (; f + 4 <= frames; f += 4) {
+                    __m128 a = _mm_loadu_ps(src + f * 2);
+                    __m128 b = _mm_loadu_ps(src + f * 2 + 4);
+                    _mm_storeu_ps(left + f, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+                    _mm_storeu_ps(right + f, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+                }
+                c = 2;
+            } else {
+                int frames4 = frames & ~3;
+                for (; c + 4 <= channels; c += 4) {
+                    for (int g = 0; g < frames4; g += 4) {
+                        const float* row = src + (size_t)g * channels + c;
+                        __m128 r0 = _mm_loadu_ps(row);
+                        __m128 r1 = _mm_loadu_ps(row + channels);
+                        __m128 r2 = _mm_loadu_ps(row + 2 * channels);
+                        __m128 r3 = _mm_loadu_ps(row + 3 * channels);
+                        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+                        _mm_storeu_ps(planar[c] + planarOffset + g, r0);
+                        _mm_storeu_ps(planar[c + 1] + planarOffset + g, r1);
+                        _mm_storeu_ps(planar[c + 2] + planarOffset + g, r2);
+                        _mm_storeu_ps(planar[c + 3] + planarOffset + g, r3);
+                    }
+                }
+                // Tail frames of the vectorised channel groups
+                for (int ch = 0; ch < c; ch++) {
+                    for (int g = frames4; g < frames; g++) {
+                        planar[ch][planarOffset + g] = src[(size_t)g * channels + ch];
+                    }
+                }
+            }
+            if (c == 2) {
+                for (; f < frames; f++) {
+                    planar[0][planarOffset + f] = src[f * 2];
+                    planar[1][planarOffset + f] = src[f * 2 + 1];
+                }
+            }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+            if (channels == 2) {
+                for (; f + 4 <= frames; f += 4) {
+                    float32x4x2_t lr = vld2q_f32(src + f * 2);
+                    vst1q_f32(planar[0] + planarOffset + f, lr.val[0]);
+                    vst1q_f32(planar[1] + planarOffset + f, lr.val[1]);
+                }
+                for (; f < frames; f++) {
+                    planar[0][planarOffset + f] = src[f * 2];
+                    planar[1][planarOffset + f] = src[f * 2 + 1];
+                }
+                c = 2;
+            }
+#endif
+        }
+        for (; c < channels; c++) {
+            T* out = planar[c] + planarOffset;
+            const T* in = src + c;
+            for (int g = 0; g < frames; g++) {
+                out[g] = in[(size_t)g * channels];
+            }
+        }
+    }
+    
+    template <typename T>
+    static inline void Interleave(T* _Nonnull dst, const T* _Nonnull const* _Nonnull planar, size_t planarOffset,
+                                  int channels, int frames) {
+        int f = 0;
+        int c = 0;
+        if constexpr (std::is_same<T, float>::value) {
+#if defined(__SSE2__) || defined(_M_X64)
+            if (channels == 2) {
+                const float* left = planar[0] + planarOffset;
+                const float* right = planar[1] + planarOffset;
+                for (; f + 4 <= frames; f += 4) {
+                    __m128 l = _mm_loadu_ps(left + f);
+                    __m128 r = _mm_loadu_ps(right + f);
+                    _mm_storeu_ps(dst + f * 2, _mm_unpacklo_ps(l, r));
+                    _mm_storeu_ps(dst + f * 2 + 4, _mm_unpackhi_ps(l, r));
+                }
+                for (; f < frames; f++) {
+                    dst[f * 2] = left[f];
+                    dst[f * 2 + 1] = right[f];
+                }
+                c = 2;
+            } else {
+                int frames4 = frames & ~3;
+                for (; c + 4 <= channels; c += 4) {
+                    for (int g = 0; g < frames4; g += 4) {
+                        __m128 r0 = _mm_loadu_ps(planar[c] + planarOffset + g);
+                        __m128 r1 = _mm_loadu_ps(planar[c + 1] + planarOffset + g);
+                        __m128 r2 = _mm_loadu_ps(planar[c + 2] + planarOffset + g);
+                        __m128 r3 = _mm_loadu_ps(planar[c + 3] + planarOffset + g);
+                        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+                        float* row = dst + (size_t)g * channels + c;
+                        _mm_storeu_ps(row, r0);
+                        _mm_storeu_ps(row + channels, r1);
+                        _mm_storeu_ps(row + 2 * channels, r2);
+                        _mm_storeu_ps(row + 3 * channels, r3);
+                    }
+                }
+                for (int ch = 0; ch < c; ch++) {
+                    for (int g = frames4; g < frames; g++) {
+                        dst[(size_t)g * channels + ch] = planar[ch][planarOffset + g];
+                    }
+                }
+            }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+            if (channels == 2) {
+                for (; f + 4 <= frames; f += 4) {
+                    float32x4x2_t lr = {{vld1q_f32(planar[0] + planarOffset + f), vld1q_f32(planar[1] + planarOffset + f)}};
+                    vst2q_f32(dst + f * 2, lr);
+                }
+                for (; f < frames; f++) {
+                    dst[f * 2] = planar[0][planarOffset + f];
+                    dst[f * 2 + 1] = planar[1][planarOffset + f];
+                }
+                c = 2;
+            }
+#endif
+        }
+        for (; c < channels; c++) {
+            const T* in = planar[c] + planarOffset;
+            T* out = dst + c;
+            for (int g = 0; g < frames; g++) {
+                out[(size_t)g * channels] = in[g];
+            }
+        }
+    }
+};
@@ -0,0 +1,582 @@
+/*
+ *   The Ultimate Ring Buffer v1.2 - Audio Frame Ring
+ *   �1999-2025 SUBBAND, Inc. & Dmitry Boldyrev
+ *   
+ *   Description:    Frame-granular interleaved multichannel audio ring
+ *   Updated:        Oct 18, 2026
+ */
+
+#pragma once
+
+#include <new>
+
+#include "ringbuffer.h"
+#include "audiokernels.h"
+#include "windowstats.h"
+#include "overview.h"
+#include "clockmap.h"
+#include "blockanalysis.h"
+
+// RingBuffer semantics (std::atomic SPSC, one slot kept empty) with the
+// frame as the unit: every read, write, peek and skip moves whole frames of
+// interleaved samples, so a partial transfer can never split a frame and
+// callers never multiply by the channel count. Storage is 64-byte aligned
+// for SIMD kernels. Frame counters are monotonic and exposed directly.
+
+template <typename SampleT>
+class AudioRing {
+private:
+    struct AlignedDelete {
+        void operator()(SampleT* p) const { ::operator delete(p, std::align_val_t(kAlign)); }
+    };
+    
+    std::atomic<int> mReadPos{0};       // in frames
+    std::atomic<int> mWritePos{0};      // in frames
+    std::atomic<uint64_t> mFramesWritten{0};
+    std::atomic<uint64_t> mFramesRead{0};
+    std::atomic<uint64_t> mDroppedFrames{0};
+    std::atomic<uint64_t> mMissedFrames{0};
+    int mChannels{0};
+    int mBufFrames{0};
+    std::unique_ptr<SampleT[], AlignedDelete> mBuffer;
+    DitherState mWriteDither;
+    DitherState mReadDither;
+    std::atomic<uint64_t> mUnderrunEvents{0};
+    std::unique_ptr<SampleT[]> mHoldFrame;  // ReadFilled() state, consumer only
+    std::unique_ptr<float[]> mMixDelta;     // ReadMixed() ramp steps, consumer only
+    uint64_t mFilledFrames{0};
+    float mFillGain{1.0f};
+    bool mInUnderrun{false};
+    std::unique_ptr<WindowStats> mStats;    // optional, fed by the producer
+    std::unique_ptr<OverviewPyramid> mOverview;
+    std::unique_ptr<RingClockMap> mClockMap;
+    std::unique_ptr<BlockAnalysisQueue> mAnalysis;
+    float mPendingPeak{0.0f};               // fused WriteFrames() analysis for EndWrite
+    uint32_t mPendingClipped{0};
+    bool mPendingAnalyzed{false};
+public:
+    static constexpr size_t kAlign = 64;
+    static constexpr int kMaxMixChannels = 64;
+    
+    explicit AudioRing(int channels, int frames = 4096) {
+        if (Init(channels, frames) < 0) {
+            throw std::runtime_error("AudioRing initialization failed");
+        }
+    }
+    
+    inline int Init(int channels, int frames) {
+        if (channels <= 0 || frames <= 0) return -1;
+        try {
+            size_t bytes = (size_t)(frames + 1) * channels * sizeof(SampleT);
+            bytes = (bytes + kAlign - 1) & ~(kAlign - 1);
+            mBuffer.reset(static_cast<SampleT*>(::operator new(bytes, std::align_val_t(kAlign))));
+            mHoldFrame.reset(new SampleT[channels]());
+            mMixDelta.reset(new float[(size_t)kMaxMixChannels * channels]);
+            mChannels = channels;
+            mBufFrames = frames + 1;
+            Empty();
+            return 0;
+        } catch (const std::bad_alloc&) {
+            RING_LOG("AudioRing: allocation failed for %d x %d", frames, channels);
+            return -1;
+        }
+    }
+    
+    inline int Channels() const {
+        return mChannels;
+    }
+    
+    inline int BufFrames() const {
+        return mBufFrames - 1;
+    }
+    
+    inline void Empty() {
+        mReadPos.store(0, std::memory_order_relaxed);
+        mWritePos.store(0, std::memory_order_relaxed);
+        mFramesRead.store(mFramesWritten.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    
+    // ===== SPACE CALCULATIONS =====
+    
+    inline int FreeFrames() const {
+        return BufFrames() - UsedFrames();
+    }
+    
+    inline int UsedFrames() const {
+        int currentRead = mReadPos.load(std::memory_order_acquire);
+        int currentWrite = mWritePos.load(std::memory_order_acquire);
+        return (currentWrite - currentRead + mBufFrames) % mBufFrames;
+    }
+    
+    // ===== FRAME READ/WRITE OPERATIONS =====
+    
+    // Writes up to `frames` interleaved frames; returns frames written (0 for null data)
+    inline int WriteFrames(const SampleT* _Nullable data, int frames) {
+        if (frames <= 0 || !data) return 0;
+        
+        int currentWrite;
+        int requested = frames;
+        if ((frames = BeginWrite(frames, currentWrite)) > 0) {
+            if (mAnalysis) {
+                // Peak/silence/clip measured in the same pass as the copy
+                mPendingPeak = 0.0f;
+                mPendingClipped = 0;
+                mPendingAnalyzed = true;
+                ForEachSegment(currentWrite, frames, [&](SampleT* ring, int offset, int count) {
+                    float peak = AudioKernels::CopyAnalyze(ring, data + (size_t)offset * mChannels, (size_t)count * mChannels,
+                                                           mAnalysis->ClipLevel(), mPendingClipped);
+                    mPendingPeak = std::max(mPendingPeak, peak);
+                });
+            } else {
+                ForEachSegment(currentWrite, frames, [&](SampleT* ring, int offset, int count) {
+                    std::memcpy(ring, data + (size_t)offset * mChannels, (size_t)count * mChannels * sizeof(SampleT));
+                });
+            }
+        }
+        EndWrite(currentWrite, frames, requested);
+        return frames;
+    }
+    
+    // Reads up to `frames` interleaved frames; returns frames read
+    inline int ReadFrames(SampleT* _Nullable data, int frames) {
+        if (frames <= 0) return 0;
+        
+        int currentRead;
+        int requested = frames;
+        if ((frames = BeginRead(frames, currentRead)) > 0 && data) {
+            ForEachSegment(currentRead, frames, [&](const SampleT* ring, int offset, int count) {
+                std::memcpy(data + (size_t)offset * mChannels, ring, (size_t)count * mChannels * sizeof(SampleT));
+            });
+        }
+        EndRead(currentRead, frames, requested);
+        return frames;
+    }
+    
+    // Copies exactly `frames` frames without consuming them; -1 if not available
+    inline int PeekFrames(SampleT* dst, int frames) const {
+        if (!dst || frames <= 0) return -1;
+        
+        int currentWrite = mWritePos.load(std::memory_order_acquire);
+        int currentRead = mReadPos.load(std::memory_order_acquire);
+        if ((currentWrite - currentRead + mBufFrames) % mBufFrames < frames) {
+            return -1; // Not enough data
+        }
+        
+        ForEachSegment(currentRead, frames, [&](const SampleT* ring, int offset, int count) {
+            std::memcpy(dst + (size_t)offset * mChannels, ring, (size_t)count * mChannels * sizeof(SampleT));
+        });
+        return frames;
+    }
+    
+    inline int SkipFrames(int frames) {
+        if (frames <= 0) return 0;
+        
+        int currentRead;
+        frames = BeginRead(frames, currentRead);
+        EndRead(currentRead, frames, frames);
+        return frames;
+    }
+    
+    // ===== MIXING READ =====
+    //
+    // Reads frames through an outChannels x Channels() gain matrix
+    // (row-major: gains[o * Channels() + i]) straight from ring memory, e.g.
+    // 5.1 to stereo. With rampFrom, each gain moves linearly from rampFrom
+    // to gains across the block, reaching gains on the last frame, so
+    // automation changes don't zipper. Float rings only; returns frames read.
+    
+    inline int ReadMixed(float* _Nonnull out, int outChannels, const float* _Nonnull gains, int frames,
+                         const float* _Nullable rampFrom = nullptr) {
+        static_assert(std::is_same_v<SampleT, float>, "ReadMixed needs a float ring");
+        if (frames <= 0 || outChannels <= 0 || outChannels > kMaxMixChannels) return 0;
+        
+        int currentRead;
+        int requested = frames;
+        if ((frames = BeginRead(frames, currentRead)) > 0) {
+            size_t count = (size_t)outChannels * mChannels;
+            const float* start = gains;
+            float* delta = mMixDelta.get();
+            if (rampFrom) {
+                // Ramp over what's actually read so the block still ends on target
+                start = rampFrom;
+                for (size_t g = 0; g < count; g++) {
+                    delta[g] = (gains[g] - rampFrom[g]) / (float)frames;
+                }
+            } else {
+                std::fill_n(delta, count, 0.0f);
+            }
+            
+            ForEachSegment(currentRead, frames, [&](const SampleT* ring, int offset, int run) {
+                AudioKernels::MixFrames(out + (size_t)offset * outChannels, outChannels, ring, mChannels,
+                                        run, start, delta, offset);
+            });
+        }
+        EndRead(currentRead, frames, requested);
+        return frames;
+    }
+    
+    // ===== UNDERRUN-SAFE READ =====
+    //
+    // ReadFilled() always delivers `frames` frames. When the ring runs short
+    // the remainder is filled by holding the last delivered frame and ramping
+    // it to silence over fadeFrames, so the output never steps; when data
+    // returns it ramps back in from the same gain. Each transition into
+    // underrun is one event, reported with its position both within the
+    // block and on the filled output's own frame timeline. Consumer only;
+    // floating-point rings.
+    
+    struct UnderrunInfo {
+        int startFrame = -1;        // block offset where an underrun began, or -1
+        int resumeFrame = -1;       // block offset where data resumed, or -1
+        uint64_t streamFrame = 0;   // FilledFrames() position of startFrame
+    };
+    
+    // Returns frames taken from the ring
+    inline int ReadFilled(SampleT* _Nonnull data, int frames, UnderrunInfo* _Nullable info = nullptr, int fadeFrames = 64) {
+        static_assert(std::is_floating_point_v<SampleT>, "ReadFilled needs a floating-point sample type");
+        if (info) *info = UnderrunInfo{};
+        if (frames <= 0) return 0;
+        
+        float step = 1.0f / (float)std::max(fadeFrames, 1);
+        int got = ReadFrames(data, frames);     // a shortfall counts in MissedFrames()
+        
+        if (got > 0) {
+            if (mInUnderrun && info) info->resumeFrame = 0;
+            mInUnderrun = false;
+            if (mFillGain < 1.0f) {
+                int ramp = std::min(got, (int)std::ceil((1.0f - mFillGain) / step));
+                AudioKernels::ApplyRamp(data, mChannels, ramp, mFillGain + step, step);
+                mFillGain = std::min(1.0f, mFillGain + step * ramp);
+            }
+            std::memcpy(mHoldFrame.get(), data + (size_t)(got - 1) * mChannels, (size_t)mChannels * sizeof(SampleT));
+            if (mFillGain < 1.0f) {
+                // Hold at unity; the current gain is tracked separately
+                for (int c = 0; c < mChannels; c++) mHoldFrame[c] /= (SampleT)mFillGain;
+            }
+        }
+        
+        if (got < frames) {
+            if (!mInUnderrun) {
+                mInUnderrun = true;
+                AddCount(mUnderrunEvents, 1);
+                if (info) {
+                    info->startFrame = got;
+                    info->streamFrame = mFilledFrames + (uint64_t)got;
+                }
+            }
+            
+            SampleT* fill = data + (size_t)got * mChannels;
+            int remaining = frames - got;
+            int ramp = std::min(remaining, (int)std::ceil(mFillGain / step));
+            for (int f = 0; f < ramp; f++) {
+                std::memcpy(fill + (size_t)f * mChannels, mHoldFrame.get(), (size_t)mChannels * sizeof(SampleT));
+            }
+            if (ramp > 0) {
+                AudioKernels::ApplyRamp(fill, mChannels, ramp, mFillGain - step, -step);
+                mFillGain = std::max(0.0f, mFillGain - step * ramp);
+            }
+            std::memset(fill + (size_t)ramp * mChannels, 0, (size_t)(remaining - ramp) * mChannels * sizeof(SampleT));
+        }
+        
+        mFilledFrames += (uint64_t)frames;
+        return got;
+    }
+    
+    // Underrun events seen by ReadFilled()
+    inline uint64_t UnderrunEvents() const {
+        return mUnderrunEvents.load(std::memory_order_relaxed);
+    }
+    
+    // Frames delivered by ReadFilled(), audio and fill alike
+    inline uint64_t FilledFrames() const {
+        return mFilledFrames;
+    }
+    
+    // ===== CONVERTING READ/WRITE =====
+    //
+    // Same as WriteFrames/ReadFrames, but the caller's buffer is in another
+    // sample format (int16_t, PackedInt24, int32_t, float, double) and the
+    // conversion happens during the copy into or out of the ring. Dither
+    // state persists per direction, so successive blocks get continuous noise.
+    
+    template <typename SrcT>
+    inline int WriteConverted(const SrcT* _Nullable data, int frames, const SampleConvertOptions& opt = {}) {
+        if (frames <= 0 || !data) return 0;
+        
+        int currentWrite;
+        int requested = frames;
+        if ((frames = BeginWrite(frames, currentWrite)) > 0) {
+            ForEachSegment(currentWrite, frames, [&](SampleT* ring, int offset, int count) {
+                AudioKernels::Convert(ring, data + (size_t)offset * mChannels, (size_t)count * mChannels, opt, mWriteDither);
+            });
+        }
+        EndWrite(currentWrite, frames, requested);
+        return frames;
+    }
+    
+    template <typename DstT>
+    inline int ReadConverted(DstT* _Nullable data, int frames, const SampleConvertOptions& opt = {}) {
+        if (frames <= 0) return 0;
+        
+        int currentRead;
+        int requested = frames;
+        if ((frames = BeginRead(frames, currentRead)) > 0 && data) {
+            ForEachSegment(currentRead, frames, [&](const SampleT* ring, int offset, int count) {
+                AudioKernels::Convert(data + (size_t)offset * mChannels, ring, (size_t)count * mChannels, opt, mReadDither);
+            });
+        }
+        EndRead(currentRead, frames, requested);
+        return frames;
+    }
+    
+    // ===== PLANAR READ/WRITE =====
+    //
+    // Interleave on write / deinterleave on read against one array per
+    // channel (channels[0 .. Channels()-1]), transposing in registers while
+    // copying across the wrap, without an intermediate buffer.
+    
+    inline int WritePlanar(const SampleT* _Nonnull const* _Nullable channels, int frames) {
+        if (frames <= 0 || !channels) return 0;
+        
+        int currentWrite;
+        int requested = frames;
+        if ((frames = BeginWrite(frames, currentWrite)) > 0) {
+            ForEachSegment(currentWrite, frames, [&](SampleT* ring, int offset, int count) {
+                AudioKernels::Interleave(ring, channels, (size_t)offset, mChannels, count);
+            });
+        }
+        EndWrite(currentWrite, frames, requested);
+        return frames;
+    }
+    
+    inline int ReadPlanar(SampleT* _Nonnull const* _Nullable channels, int frames) {
+        if (frames <= 0) return 0;
+        
+        int currentRead;
+        int requested = frames;
+        if ((frames = BeginRead(frames, currentRead)) > 0 && channels) {
+            ForEachSegment(currentRead, frames, [&](const SampleT* ring, int offset, int count) {
+                AudioKernels::Deinterleave(channels, (size_t)offset, ring, mChannels, count);
+            });
+        }
+        EndRead(currentRead, frames, requested);
+        return frames;
+    }
+    
+    // ===== WINDOW STATISTICS =====
+    //
+    // Optional sliding-window min/max/mean/RMS over the last windowFrames
+    // frames written, maintained on every write path (see WindowStats).
+    // Enable before streaming starts; query from any thread.
+    
+    inline int EnableWindowStats(int windowFrames) {
+        try {
+            mStats = std::make_unique<WindowStats>(mChannels, windowFrames);
+        } catch (const std::exception&) {
+            RING_LOG("AudioRing: failed to enable window stats (%d frames)", windowFrames);
+            return -1;
+        }
+        return 0;
+    }
+    
+    inline const WindowStats* _Nullable Stats() const {
+        return mStats.get();
+    }
+    
+    // ===== WAVEFORM OVERVIEW =====
+    //
+    // Optional min/max pyramid maintained on every write path (see
+    // OverviewPyramid), retaining at least the ring's capacity by default.
+    // Query positions are on the FramesWritten() timeline; enabling
+    // mid-stream starts the pyramid at the current FramesWritten().
+    
+    inline int EnableOverview(int baseShift = 4, int levels = 8, int retainFrames = 0) {
+        try {
+            mOverview = std::make_unique<OverviewPyramid>(mChannels, baseShift, levels,
+                                                          retainFrames > 0 ? retainFrames : BufFrames(),
+                                                          FramesWritten());
+        } catch (const std::exception&) {
+            RING_LOG("AudioRing: failed to enable overview (%d levels)", levels);
+            return -1;
+        }
+        return 0;
+    }
+    
+    inline const OverviewPyramid* _Nullable Overview() const {
+        return mOverview.get();
+    }
+    
+    // ===== HOST CLOCK MAPPING =====
+    //
+    // Optional frame <-> host time map on the FramesWritten()/FramesRead()
+    // timeline (see RingClockMap). The producer anchors its write position
+    // with the device timestamp of the frames it is about to write; anyone
+    // can then ask when a given frame was captured, or when the frame at the
+    // read head will play.
+    
+    inline int EnableClockMap(double sampleRate, double bandwidthHz = 1.0) {
+        try {
+            mClockMap = std::make_unique<RingClockMap>(sampleRate, bandwidthHz);
+        } catch (const std::exception&) {
+            RING_LOG("AudioRing: failed to enable clock map (%.1f Hz)", sampleRate);
+            return -1;
+        }
+        return 0;
+    }
+    
+    inline const RingClockMap* _Nullable ClockMap() const {
+        return mClockMap.get();
+    }
+    
+    // Producer: the next frame written corresponds to host time `nanos`
+    inline void AnchorWrite(uint64_t nanos) {
+        if (mClockMap) mClockMap->AddAnchor(FramesWritten(), nanos);
+    }
+    
+    // Host time of the frame at the read head; NaN without a locked map
+    inline double ReadHeadTime() const {
+        if (!mClockMap || !mClockMap->Locked()) return std::nan("");
+        return mClockMap->TimeForFrame((double)FramesRead());
+    }
+    
+    // ===== WRITE-SIDE BLOCK ANALYSIS =====
+    //
+    // Optional per-write metadata (see BlockAnalysisQueue). WriteFrames()
+    // measures while it copies; the converting and planar writes measure the
+    // ring segment they just filled. AnalyzeNext() summarises the next
+    // `frames` frames at the read head without reading them.
+    
+    inline int EnableWriteAnalysis(float silenceThreshold = 0.0f, float clipLevel = 1.0f, int maxBlocks = 256) {
+        if (maxBlocks <= 0) return -1;
+        try {
+            mAnalysis = std::make_unique<BlockAnalysisQueue>(maxBlocks, silenceThreshold, clipLevel);
+        } catch (const std::bad_alloc&) {
+            RING_LOG("AudioRing: failed to enable write analysis (%d blocks)", maxBlocks);
+            return -1;
+        }
+        return 0;
+    }
+    
+    // Consumer: false if analysis is off or nothing queued covers the range
+    inline bool AnalyzeNext(int frames, BlockAnalysis& out) const {
+        if (!mAnalysis || frames <= 0) return false;
+        uint64_t from = FramesRead();
+        return mAnalysis->Aggregate(from, from + (uint64_t)frames, out);
+    }
+    
+    inline uint64_t AnalysisDropped() const {
+        return mAnalysis ? mAnalysis->Dropped() : 0;
+    }
+    
+    // ===== FRAME METRICS =====
+    
+    // Monotonic totals since construction
+    inline uint64_t FramesWritten() const {
+        return mFramesWritten.load(std::memory_order_acquire);
+    }
+    
+    inline uint64_t FramesRead() const {
+        return mFramesRead.load(std::memory_order_acquire);
+    }
+    
+    // Frames a writer offered that didn't fit (overrun) / a reader asked for
+    // that weren't there (underrun)
+    inline uint64_t DroppedFrames() const {
+        return mDroppedFrames.load(std::memory_order_relaxed);
+    }
+    
+    inline uint64_t MissedFrames() const {
+        return mMissedFrames.load(std::memory_order_relaxed);
+    }
+    
+    AudioRing(const AudioRing&) = delete;
+    AudioRing& operator=(const AudioRing&) = delete;
+    AudioRing(AudioRing&& other) noexcept = delete;
+    AudioRing& operator=(AudioRing&& other) noexcept = delete;
+    
+private:
+    // ===== INTERNAL HELPERS =====
+    
+    // Calls fn(ringPtr, frameOffset, frameCount) for the (at most two)
+    // contiguous runs covering `frames` frames from ring position pos
+    template <typename Fn>
+    inline void ForEachSegment(int pos, int frames, Fn&& fn) const {
+        int firstPart = std::min(frames, mBufFrames - pos);
+        fn(&mBuffer[(size_t)pos * mChannels], 0, firstPart);
+        if (frames > firstPart) {
+            fn(&mBuffer[0], firstPart, frames - firstPart);
+        }
+    }
+    
+    inline int BeginWrite(int frames, int& currentWrite) const {
+        int currentRead = mReadPos.load(std::memory_order_acquire);
+        currentWrite = mWritePos.load(std::memory_order_relaxed);
+        int available = (currentRead - currentWrite - 1 + mBufFrames) % mBufFrames;
+        return std::min(frames, available);
+    }
+    
+    inline void EndWrite(int currentWrite, int frames, int requested) {
+        if (frames < requested) {
+            AddCount(mDroppedFrames, requested - frames);
+        }
+        if (frames <= 0) return;
+        
+        if (mStats) {
+            ForEachSegment(currentWrite, frames, [&](const SampleT* ring, int, int count) {
+                mStats->Push(ring, count);
+            });
+        }
+        if (mOverview) {
+            ForEachSegment(currentWrite, frames, [&](const SampleT* ring, int, int count) {
+                mOverview->Push(ring, count);
+            });
+        }
+        if (mAnalysis) {
+            if (!mPendingAnalyzed) {
+                mPendingPeak = 0.0f;
+                mPendingClipped = 0;
+                ForEachSegment(currentWrite, frames, [&](const SampleT* ring, int, int count) {
+                    float peak = AudioKernels::CopyAnalyze<SampleT>(nullptr, ring, (size_t)count * mChannels,
+                                                                    mAnalysis->ClipLevel(), mPendingClipped);
+                    mPendingPeak = std::max(mPendingPeak, peak);
+                });
+            }
+            mAnalysis->Push(FramesWritten(), frames, mPendingPeak, mPendingClipped);
+            mPendingAnalyzed = false;
+        }
+        
+        int endWrite = (currentWrite + frames) % mBufFrames;
+        AddCount(mFramesWritten, frames);
+        mWritePos.store(endWrite, std::memory_order_release);
+        RING_LOG("AudioRing: wrote %d frames, writePos %d→%d", frames, currentWrite, endWrite);
+    }
+    
+    inline int BeginRead(int frames, int& currentRead) const {
+        int currentWrite = mWritePos.load(std::memory_order_acquire);
+        currentRead = mReadPos.load(std::memory_order_relaxed);
+        int available = (currentWrite - currentRead + mBufFrames) % mBufFrames;
+        return std::min(frames, available);
+    }
+    
+    inline void EndRead(int currentRead, int frames, int requested) {
+        if (frames < requested) {
+            AddCount(mMissedFrames, requested - frames);
+        }
+        if (frames <= 0) return;
+        
+        int endRead = (currentRead + frames) % mBufFrames;
+        AddCount(mFramesRead, frames);
+        mReadPos.store(endRead, std::memory_order_release);
+        if (mAnalysis) {
+            mAnalysis->Retire(FramesRead());
+        }
+        RING_LOG("AudioRing: read %d frames, readPos %d→%d", frames, currentRead, endRead);
+    }
+    
+    // Single writer per counter
+    static inline void AddCount(std::atomic<uint64_t>& counter, int64_t delta) {
+        counter.store(counter.load(std::memory_order_relaxed) + (uint64_t)delta, std::memory_order_relaxed);
+    }
+};
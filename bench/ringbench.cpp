@@ -0,0 +1,220 @@
+/*
+ *   The Ultimate Ring Buffer v1.2 - SPSC Throughput Benchmark
+ *   �1999-2025 SUBBAND, Inc. & Dmitry Boldyrev
+ *   
+ *   Description:    WriteData/ReadData throughput across message sizes, capacities and wrap patterns
+ *   Updated:        Oct 18, 2026
+ */
+
+// One producer and one consumer thread, pinned to separate CPUs where the
+// platform allows, stream fixed-size messages through a RingBuffer with
+// WriteData()/ReadData() for a fixed time per case. The matrix covers:
+//
+//   message size   1 B .. 1 MiB (powers of 8)
+//   capacity       64 KiB, 1 MiB, 8 MiB internal buffer
+//   capacity kind  pow2 (internal size 2^k) vs odd (2^k + 1021, rounded up
+//                  to whole messages so the pattern holds on every lap)
+//   pattern        aligned (messages start on the wrap point) vs straddle
+//                  (ring pre-offset by half a message, so wrapping messages
+//                  split in two copies)
+//
+// Cases whose message exceeds half the capacity are skipped, as is straddle
+// for 1-byte messages, which can't split. Each message
+// carries its sequence number in its first bytes and the consumer checks
+// it, so a broken ring shows up as "errors" rather than a fast number.
+// Results go to stdout (or --output) as JSON.
+//
+//   ringbench [--seconds S] [--quick] [--output FILE]
+
+#include "../ringbuffer.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+struct BenchCase {
+    int messageBytes;
+    int capacity;           // internal buffer size (RingBuffer size + 1)
+    bool pow2;
+    bool straddle;
+};
+
+struct BenchResult {
+    BenchCase config;
+    double seconds;
+    uint64_t messages;
+    uint64_t errors;
+};
+
+bool PinThread(std::thread& thread, int cpu) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#else
+    (void)thread;
+    (void)cpu;
+    return false;
+#endif
+}
+
+// Writes or reads all of `bytes`, spinning (then yielding) while the ring
+// is full/empty; returns false if stop was raised first
+template <typename Op>
+bool Transfer(Op&& op, uint8_t* data, int bytes, const std::atomic<bool>& stop) {
+    int done = 0;
+    int spins = 0;
+    while (done < bytes) {
+        int moved = op(data + done, bytes - done);
+        if (moved > 0) {
+            done += moved;
+            spins = 0;
+            continue;
+        }
+        if (stop.load(std::memory_order_relaxed)) return false;
+        if (++spins > 64) std::this_thread::yield();
+    }
+    return true;
+}
+
+BenchResult RunCase(const BenchCase& config, double seconds, int producerCpu, int consumerCpu, bool& pinned) {
+    RingBuffer ring(config.capacity - 1);
+    
+    if (config.straddle) {
+        int offset = config.messageBytes / 2;
+        std::vector<uint8_t> prime(offset);
+        ring.WriteData(prime.data(), offset);
+        ring.ReadData(prime.data(), offset);
+    }
+    
+    std::atomic<bool> stop{false};
+    std::atomic<bool> go{false};
+    uint64_t consumed = 0;
+    uint64_t errors = 0;
+    int stamp = std::min(config.messageBytes, (int)sizeof(uint64_t));
+    
+    std::thread producer([&] {
+        std::vector<uint8_t> message(config.messageBytes, 0xA5);
+        while (!go.load(std::memory_order_acquire)) {}
+        for (uint64_t seq = 0; !stop.load(std::memory_order_relaxed); seq++) {
+            std::memcpy(message.data(), &seq, stamp);
+            if (!Transfer([&](uint8_t* p, int n) { return ring.WriteData(p, n); }, message.data(), config.messageBytes, stop)) break;
+        }
+    });
+    
+    std::thread consumer([&] {
+        std::vector<uint8_t> message(config.messageBytes);
+        while (!go.load(std::memory_order_acquire)) {}
+        for (uint64_t seq = 0; ; seq++) {
+            if (!Transfer([&](uint8_t* p, int n) { return ring.ReadData(p, n); }, message.data(), config.messageBytes, stop)) break;
+            uint64_t expected = seq;
+            if (std::memcmp(message.data(), &expected, stamp) != 0) errors++;
+            consumed = seq + 1;
+        }
+    });
+    
+    pinned = PinThread(producer, producerCpu) && PinThread(consumer, consumerCpu);
+    
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop.store(true, std::memory_order_relaxed);
+    producer.join();
+    consumer.join();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    return BenchResult{config, elapsed, consumed, errors};
+}
+
+void WriteJson(FILE* out, const std::vector<BenchResult>& results, unsigned cpus, bool pinned, double seconds) {
+    std::fprintf(out, "{\n  \"benchmark\": \"ringbench\",\n  \"version\": \"1.2\",\n");
+    std::fprintf(out, "  \"cpus\": %u,\n  \"pinned\": %s,\n  \"seconds_per_case\": %.3f,\n  \"cases\": [\n",
+                 cpus, pinned ? "true" : "false", seconds);
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        double bytes = (double)r.messages * r.config.messageBytes;
+        std::fprintf(out,
+                     "    {\"message_bytes\": %d, \"capacity\": %d, \"capacity_kind\": \"%s\", \"pattern\": \"%s\", "
+                     "\"seconds\": %.6f, \"messages\": %llu, \"bytes_per_second\": %.1f, \"messages_per_second\": %.1f, "
+                     "\"errors\": %llu}%s\n",
+                     r.config.messageBytes, r.config.capacity, r.config.pow2 ? "pow2" : "odd",
+                     r.config.straddle ? "straddle" : "aligned", r.seconds, (unsigned long long)r.messages,
+                     bytes / r.seconds, (double)r.messages / r.seconds, (unsigned long long)r.errors,
+                     i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n}\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    double seconds = 0.25;
+    bool quick = false;
+    const char* outputPath = nullptr;
+    
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--seconds" && i + 1 < argc) {
+            seconds = std::atof(argv[++i]);
+        } else if (arg == "--quick") {
+            quick = true;
+        } else if (arg == "--output" && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else {
+            std::fprintf(stderr, "usage: %s [--seconds S] [--quick] [--output FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (seconds <= 0.0) seconds = 0.25;
+    
+    std::vector<int> messageSizes = quick ? std::vector<int>{1, 64, 4096, 262144}
+                                          : std::vector<int>{1, 8, 64, 512, 4096, 32768, 262144, 1048576};
+    std::vector<int> capacities = quick ? std::vector<int>{1 << 16, 1 << 20}
+                                        : std::vector<int>{1 << 16, 1 << 20, 1 << 23};
+    
+    unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+    int producerCpu = 0;
+    int consumerCpu = cpus > 1 ? 1 : 0;
+    bool allPinned = true;
+    
+    std::vector<BenchResult> results;
+    for (int capacity : capacities) {
+        for (bool pow2 : {true, false}) {
+            for (int messageBytes : messageSizes) {
+                int internal = pow2 ? capacity : capacity + (1021 + messageBytes - 1) / messageBytes * messageBytes;
+                if (messageBytes > internal / 2) continue;
+                for (bool straddle : {false, true}) {
+                    if (straddle && messageBytes == 1) continue;
+                    bool pinned = false;
+                    results.push_back(RunCase(BenchCase{messageBytes, internal, pow2, straddle},
+                                              seconds, producerCpu, consumerCpu, pinned));
+                    allPinned = allPinned && pinned;
+                    std::fprintf(stderr, "ringbench: %7d B msgs, %8d B ring (%s, %s): %.1f MB/s\n",
+                                 messageBytes, internal, pow2 ? "pow2" : "odd", straddle ? "straddle" : "aligned",
+                                 (double)results.back().messages * messageBytes / results.back().seconds / 1e6);
+                }
+            }
+        }
+    }
+    
+    FILE* out = stdout;
+    if (outputPath && !(out = std::fopen(outputPath, "w"))) {
+        std::fprintf(stderr, "ringbench: cannot open %s\n", outputPath);
+        return 1;
+    }
+    WriteJson(out, results, cpus, allPinned, seconds);
+    if (out != stdout) std::fclose(out);
+    
+    for (const BenchResult& r : results) {
+        if (r.errors) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+/*
+ *   The Ultimate Ring Buffer v1.2 - Write-Side Block Analysis
+ *   �1999-2025 SUBBAND, Inc. & Dmitry Boldyrev
+ *   
+ *   Description:    Per-block peak/silence/clip metadata queued alongside ring audio
+ *   Updated:        Oct 18, 2026
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "ringbuffer.h"
+
+// What the producer learned about each written block while copying it in:
+// its peak, whether it is silent (peak at or below a threshold; 0 means
+// all-zero) and how many samples reached the clip level. Blocks are queued
+// SPSC in frame order next to the audio, so the consumer can gate or meter
+// the frames it is about to read without touching them. Entries retire as
+// the read head passes them. A full queue drops the newest block's entry
+// and counts it.
+
+struct BlockAnalysis {
+    uint64_t startFrame{0};     // on the ring's FramesWritten() timeline
+    int frames{0};
+    float peak{0.0f};
+    uint32_t clipped{0};
+    bool silent{true};
+};
+
+class BlockAnalysisQueue {
+public:
+    BlockAnalysisQueue(int capacity, float silenceThreshold, float clipLevel)
+        : mSilenceThreshold(silenceThreshold), mClipLevel(clipLevel) {
+        int slots = 1;
+        while (slots < capacity) slots <<= 1;
+        mBlocks.reset(new BlockAnalysis[slots]);
+        mMask = slots - 1;
+    }
+    
+    inline float SilenceThreshold() const { return mSilenceThreshold; }
+    inline float ClipLevel() const { return mClipLevel; }
+    
+    // Producer
+    inline void Push(uint64_t startFrame, int frames, float peak, uint32_t clipped) {
+        uint64_t tail = mTail.load(std::memory_order_relaxed);
+        if (tail - mHead.load(std::memory_order_acquire) > (uint64_t)mMask) {
+            mDropped.store(mDropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        mBlocks[tail & mMask] = BlockAnalysis{startFrame, frames, peak, clipped, peak <= mSilenceThreshold};
+        mTail.store(tail + 1, std::memory_order_release);
+    }
+    
+    // Consumer: merges every block overlapping [from, to). Returns false if
+    // no queued block covers any of it (e.g. its entry was dropped). With
+    // partial coverage out.frames < to - from and the missing frames are
+    // unknown, not silent: `silent` is only true when every frame is covered.
+    inline bool Aggregate(uint64_t from, uint64_t to, BlockAnalysis& out) const {
+        out = BlockAnalysis{from, 0, 0.0f, 0, true};
+        uint64_t tail = mTail.load(std::memory_order_acquire);
+        bool any = false;
+        for (uint64_t i = mHead.load(std::memory_order_relaxed); i != tail; i++) {
+            const BlockAnalysis& block = mBlocks[i & mMask];
+            if (block.startFrame >= to) break;
+            if (block.startFrame + (uint64_t)block.frames <= from) continue;
+            
+            uint64_t begin = std::max(block.startFrame, from);
+            uint64_t end = std::min(block.startFrame + (uint64_t)block.frames, to);
+            out.frames += (int)(end - begin);
+            out.peak = std::max(out.peak, block.peak);
+            out.clipped += block.clipped;
+            out.silent = out.silent && block.silent;
+            any = true;
+        }
+        if (out.frames != (int)(to - from)) out.silent = false;
+        return any;
+    }
+    
+    // Consumer: drops entries wholly before readFrame
+    inline void Retire(uint64_t readFrame) {
+        uint64_t head = mHead.load(std::memory_order_relaxed);
+        uint64_t tail = mTail.load(std::memory_order_acquire);
+        while (head != tail) {
+            const BlockAnalysis& block = mBlocks[head & mMask];
+            if (block.startFrame + (uint64_t)block.frames > readFrame) break;
+            head++;
+        }
+        mHead.store(head, std::memory_order_release);
+    }
+    
+    inline uint64_t Dropped() const {
+        return mDropped.load(std::memory_order_relaxed);
+    }
+    
+    BlockAnalysisQueue(const BlockAnalysisQueue&) = delete;
+    BlockAnalysisQueue& operator=(const BlockAnalysisQueue&) = delete;
+    
+private:
+    std::unique_ptr<BlockAnalysis[]> mBlocks;
+    int mMask{0};
+    float mSilenceThreshold;
+    float mClipLevel;
+    std::atomic<uint64_t> mHead{0};
+    std::atomic<uint64_t> mTail{0};
+    std::atomic<uint64_t> mDropped{0};
+};
@@ -0,0 +1,161 @@
+/*
+ *   The Ultimate Ring Buffer v1.2 - Frame/Host Clock Mapping
+ *   �1999-2025 SUBBAND, Inc. & Dmitry Boldyrev
+ *   
+ *   Description:    DLL-smoothed mapping between absolute frame positions and host time
+ *   Updated:        Oct 18, 2026
+ */
+
+#pragma once
+
+#include <cmath>
+
+#include "ringbuffer.h"
+
+// Maps absolute frame positions (an AudioRing's FramesWritten() /
+// FramesRead() timeline) to host time in nanoseconds and back. The producer
+// feeds (frame, host time) anchors, typically one per device callback with
+// the callback's capture or presentation timestamp; a second-order
+// delay-locked loop filters the timestamp jitter and tracks the device's
+// actual rate. Readers query through a seqlock-published (frame, time,
+// rate) triple, so either direction is O(1) from any thread.
+//
+// Host time is whatever clock the anchors use (RingClock::ToNanos() of
+// RingClock::Now(), CLOCK_MONOTONIC, ...); the map doesn't care, as long as
+// it is consistent.
+
+class RingClockMap {
+public:
+    // bandwidthHz sets the DLL's loop bandwidth: lower rejects more jitter,
+    // higher follows rate changes faster
+    explicit RingClockMap(double sampleRate = 48000.0, double bandwidthHz = 1.0) {
+        if (Init(sampleRate, bandwidthHz) < 0) {
+            throw std::runtime_error("RingClockMap initialization failed");
+        }
+    }
+    
+    inline int Init(double sampleRate, double bandwidthHz) {
+        if (sampleRate <= 0.0 || bandwidthHz <= 0.0) return -1;
+        mNominalRate = 1e9 / sampleRate;
+        mBandwidth = bandwidthHz;
+        Reset();
+        return 0;
+    }
+    
+    // Restarts locking from the next anchor (after a device restart or seek)
+    inline void Reset() {
+        mLocked = false;
+        mFrame = 0;
+        mTime = 0.0;
+        mRate = mNominalRate;
+        Publish();
+    }
+    
+    // Producer: frame `frame` was captured/presented at host time `nanos`.
+    // Anchors must move forward in frames.
+    inline void AddAnchor(uint64_t frame, uint64_t nanos) {
+        if (!mLocked) {
+            mFrame = frame;
+            mTime = (double)nanos;
+            mLocked = true;
+            Publish();
+            return;
+        }
+        if (frame <= mFrame) return;
+        
+        double frames = (double)(frame - mFrame);
+        double predicted = mTime + mRate * frames;
+        double error = (double)nanos - predicted;
+        
+        // Critically damped 2nd-order loop, coefficients scaled to this update's span
+        double omega = 2.0 * kRingPi * mBandwidth * (frames * mRate * 1e-9);
+        omega = std::min(omega, 1.0);
+        mTime = predicted + std::sqrt(2.0) * omega * error;
+        mRate += omega * omega * error / frames;
+        mRate = std::clamp(mRate, 0.5 * mNominalRate, 2.0 * mNominalRate);
+        mFrame = frame;
+        Publish();
+    }
+    
+    inline bool Locked() const {
+        return mPublished.load().locked;
+    }
+    
+    // Host time of an absolute frame position (fractional positions allowed)
+    inline double TimeForFrame(double frame) const {
+        Mapping m = mPublished.load();
+        return m.time + (frame - (double)m.frame) * m.rate;
+    }
+    
+    // Absolute (fractional) frame position at a host time
+    inline double FrameForTime(double nanos) const {
+        Mapping m = mPublished.load();
+        return (double)m.frame + (nanos - m.time) / m.rate;
+    }
+    
+    // Smoothed nanoseconds per frame and the corresponding sample rate
+    inline double NanosPerFrame() const {
+        return mPublished.load().rate;
+    }
+    
+    inline double MeasuredSampleRate() const {
+        return 1e9 / NanosPerFrame();
+    }
+    
+    RingClockMap(const RingClockMap&) = delete;
+    RingClockMap& operator=(const RingClockMap&) = delete;
+    
+private:
+    struct Mapping {
+        uint64_t frame;
+        double time;
+        double rate;
+        bool locked;
+    };
+    
+    // Single-writer seqlock around a small POD
+    class PublishedMapping {
+    public:
+        inline void store(const Mapping& m) {
+            uint32_t sequence = mSequence.load(std::memory_order_relaxed);
+            mSequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            mFrame.store(m.frame, std::memory_order_relaxed);
+            mTime.store(m.time, std::memory_order_relaxed);
+            mRate.store(m.rate, std::memory_order_relaxed);
+            mLocked.store(m.locked, std::memory_order_relaxed);
+            mSequence.store(sequence + 2, std::memory_order_release);
+        }
+        
+        inline Mapping load() const {
+            for (;;) {
+                uint32_t before = mSequence.load(std::memory_order_acquire);
+                if (before & 1) continue;
+                Mapping m{mFrame.load(std::memory_order_relaxed), mTime.load(std::memory_order_relaxed),
+                          mRate.load(std::memory_order_relaxed), mLocked.load(std::memory_order_relaxed)};
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (mSequence.load(std::memory_order_relaxed) == before) return m;
+            }
+        }
+        
+    private:
+        std::atomic<uint32_t> mSequence{0};
+        std::atomic<uint64_t> mFrame{0};
+        std::atomic<double> mTime{0.0};
+        std::atomic<double> mRate{0.0};
+        std::atomic<bool> mLocked{false};
+    };
+    
+    inline void Publish() {
+        mPublished.store(Mapping{mFrame, mTime, mRate, mLocked});
+    }
+    
+    // Producer-side loop state
+    double mNominalRate{0.0};           // ns per frame at the nominal sample rate
+    double mBandwidth{1.0};
+    bool mLocked{false};
+    uint64_t mFrame{0};
+    double mTime{0.0};
+    double mRate{0.0};
+    PublishedMapping mPublished;
+};
@@ -0,0 +1,303 @@
+/*
+ *   The Ultimate Ring Buffer v1.2 - Delay Line
+ *   �1999-2025 SUBBAND, Inc. & Dmitry Boldyrev
+ *   
+ *   Description:    Multichannel delay line with fractional-delay interpolated reads
+ *   Updated:        Oct 18, 2026
+ */
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include "audiokernels.h"
+
+// Delay-line mode: the writer appends interleaved frames and never
+// consumes; readers address history by a (fractional) delay in frames
+// behind the write head. Capacity is a power of two so every tap address is
+// a mask, and the oldest frames are simply overwritten.
+//
+// Delays are measured from the frame being produced: for a block read of N
+// frames right after writing N frames, output frame i sits at input frame
+// (FramesWritten() - N + i) - delay. The single-frame ReadAtDelay() is
+// relative to the newest frame. Interpolators need a little look-ahead, so
+// delays are clamped to [MinDelay(mode), MaxDelay()]. Block reads return
+// frames produced, or -1 (nothing written) for more than MaxBlock() frames.
+//
+// Each output frame is a weighted sum of 2 (linear), 4 (Hermite) or
+// 2 * sincHalfWidth (windowed sinc) input frames; the weights are computed
+// once per frame (once per block for a fixed delay) and the sum runs across
+// channels with SIMD. Single thread: write and read from the same callback.
+
+class DelayLine {
+public:
+    enum class Interp { Linear, Hermite, Sinc };
+    
+    static constexpr int kSincPhases = 256;
+    
+    explicit DelayLine(int channels, int maxDelayFrames, int maxBlockFrames = 4096, int sincHalfWidth = 8) {
+        if (Init(channels, maxDelayFrames, maxBlockFrames, sincHalfWidth) < 0) {
+            throw std::runtime_error("DelayLine initialization failed");
+        }
+    }
+    
+    // sincHalfWidth must be in [2, kMaxTaps / 2]
+    inline int Init(int channels, int maxDelayFrames, int maxBlockFrames, int sincHalfWidth) {
+        if (channels <= 0 || maxDelayFrames < 0 || maxBlockFrames <= 0) return -1;
+        if (sincHalfWidth < 2 || sincHalfWidth > kMaxTaps / 2) return -1;
+        
+        int needed = maxDelayFrames + maxBlockFrames + sincHalfWidth + 4;
+        int frames = 1;
+        while (frames < needed) frames <<= 1;
+        try {
+            mBuffer.assign((size_t)frames * channels, 0.0f);
+            BuildSincTable(sincHalfWidth);
+        } catch (const std::bad_alloc&) {
+            RING_LOG("DelayLine: allocation failed for %d x %d", frames, channels);
+            return -1;
+        }
+        mChannels = channels;
+        mMask = frames - 1;
+        mMaxDelay = maxDelayFrames;
+        mMaxBlock = maxBlockFrames;
+        mSincHalf = sincHalfWidth;
+        mWriteCount = 0;
+        return 0;
+    }
+    
+    inline int Channels() const { return mChannels; }
+    inline int MaxDelay() const { return mMaxDelay; }
+    inline int MaxBlock() const { return mMaxBlock; }
+    inline uint64_t FramesWritten() const { return mWriteCount; }
+    
+    inline float MinDelay(Interp mode) const {
+        return (mode == Interp::Linear) ? 0.0f : (mode == Interp::Hermite) ? 1.0f : (float)mSincHalf;
+    }
+    
+    inline void Clear() {
+        std::fill(mBuffer.begin(), mBuffer.end(), 0.0f);
+    }
+    
+    // Appends interleaved frames; older history is overwritten
+    inline void Write(const float* _Nonnull data, int frames) {
+        while (frames > 0) {
+            int pos = (int)(mWriteCount & (uint64_t)mMask);
+            int run = std::min(frames, mMask + 1 - pos);
+            std::memcpy(&mBuffer[(size_t)pos * mChannels], data, (size_t)run * mChannels * sizeof(float));
+            data += (size_t)run * mChannels;
+            frames -= run;
+            mWriteCount += run;
+        }
+    }
+    
+    // One frame `delay` frames behind the newest one
+    inline void ReadAtDelay(float delay, float* _Nonnull frameOut, Interp mode = Interp::Linear) const {
+        delay = ClampDelay(delay, mode);
+        double position = (double)mWriteCount - 1.0 - delay;
+        int64_t index = (int64_t)std::floor(position);
+        float weights[kMaxTaps];
+        int first = Weights(mode, (float)(position - (double)index), weights);
+        Sum(frameOut, index + first, weights, TapCount(mode));
+    }
+    
+    // `frames` output frames at a fixed delay, aligned to the last `frames` written
+    inline int ReadBlock(float* _Nonnull out, int frames, float delay, Interp mode = Interp::Linear) const {
+        if (!CheckBlock(frames)) return -1;
+        delay = ClampDelay(delay, mode);
+        double position = (double)mWriteCount - frames - delay;
+        int64_t index = (int64_t)std::floor(position);
+        float weights[kMaxTaps];
+        int first = Weights(mode, (float)(position - (double)index), weights);
+        int taps = TapCount(mode);
+        
+        for (int i = 0; i < frames; i++) {
+            Sum(out + (size_t)i * mChannels, index + first + i, weights, taps);
+        }
+        return frames;
+    }
+    
+    // Modulated delay: one delay value per output frame (chorus, flanger, vibrato)
+    inline int ReadModulated(float* _Nonnull out, const float* _Nonnull delays, int frames,
+                             Interp mode = Interp::Linear) const {
+        if (!CheckBlock(frames)) return -1;
+        double base = (double)mWriteCount - frames;
+        int taps = TapCount(mode);
+        float weights[kMaxTaps];
+        
+        for (int i = 0; i < frames; i++) {
+            double position = base + i - ClampDelay(delays[i], mode);
+            int64_t index = (int64_t)std::floor(position);
+            int first = Weights(mode, (float)(position - (double)index), weights);
+            Sum(out + (size_t)i * mChannels, index + first, weights, taps);
+        }
+        return frames;
+    }
+    
+    // One tap of a multi-tap read; fractional delays are linearly interpolated
+    struct Tap {
+        float delay;
+        float gain;
+    };
+    
+    // Sums all taps into `out` (interleaved, `frames` frames) in a single pass
+    inline int ReadTaps(float* _Nonnull out, int frames, const Tap* _Nonnull taps, int tapCount) const {
+        if (!CheckBlock(frames) || tapCount < 0) return -1;
+        std::memset(out, 0, (size_t)frames * mChannels * sizeof(float));
+        ForEachTapFrame(frames, taps, tapCount, [&](int, int frame, const float* a, const float* b, float wa, float wb) {
+            float* dst = out + (size_t)frame * mChannels;
+            AudioKernels::AccumulateFrame(dst, a, wa, mChannels);
+            if (wb != 0.0f) AudioKernels::AccumulateFrame(dst, b, wb, mChannels);
+        });
+        return frames;
+    }
+    
+    // Writes each tap to its own interleaved output, outs[tap], in a single pass
+    inline int ReadTaps(float* _Nonnull const* _Nonnull outs, int frames, const Tap* _Nonnull taps, int tapCount) const {
+        if (!CheckBlock(frames) || tapCount < 0) return -1;
+        ForEachTapFrame(frames, taps, tapCount, [&](int tap, int frame, const float* a, const float* b, float wa, float wb) {
+            float* dst = outs[tap] + (size_t)frame * mChannels;
+            AudioKernels::ScaleFrame(dst, a, wa, mChannels);
+            if (wb != 0.0f) AudioKernels::AccumulateFrame(dst, b, wb, mChannels);
+        });
+        return frames;
+    }
+    
+    DelayLine(const DelayLine&) = delete;
+    DelayLine& operator=(const DelayLine&) = delete;
+    
+private:
+    static constexpr int kMaxTaps = 64;
+    
+    static constexpr int kTapBatch = 64;
+    static constexpr int kPrefetchFrames = 8;
+    
+    // Walks frames in the outer loop and taps in the inner one so each
+    // output frame stays hot. Tap positions and weights are resolved once per
+    // block; each step is then an add and a mask, with the frame a few steps
+    // ahead prefetched for every tap.
+    // fn(tap, frame, olderFrame, newerFrame, olderWeight, newerWeight)
+    template <typename Fn>
+    inline void ForEachTapFrame(int frames, const Tap* _Nonnull taps, int tapCount, Fn&& fn) const {
+        int64_t start[kTapBatch];
+        float weightA[kTapBatch];
+        float weightB[kTapBatch];
+        
+        for (int batch = 0; batch < tapCount; batch += kTapBatch) {
+            int count = std::min(kTapBatch, tapCount - batch);
+            for (int k = 0; k < count; k++) {
+                double position = (double)mWriteCount - frames - ClampDelay(taps[batch + k].delay, Interp::Linear);
+                int64_t index = (int64_t)std::floor(position);
+                float t = (float)(position - (double)index);
+                start[k] = index;
+                weightA[k] = taps[batch + k].gain * (1.0f - t);
+                weightB[k] = taps[batch + k].gain * t;
+            }
+            
+            for (int i = 0; i < frames; i++) {
+                for (int k = 0; k < count; k++) {
+                    int64_t index = start[k] + i;
+                    RING_PREFETCH(FrameAt(index + kPrefetchFrames));
+                    fn(batch + k, i, FrameAt(index), FrameAt(index + 1), weightA[k], weightB[k]);
+                }
+            }
+        }
+    }
+    
+    // History only reaches MaxBlock() frames past the deepest delay
+    inline bool CheckBlock(int frames) const {
+        if (frames < 0 || frames > mMaxBlock) {
+            RING_LOG("DelayLine: block of %d frames outside [0, %d]", frames, mMaxBlock);
+            return false;
+        }
+        return true;
+    }
+    
+    inline float ClampDelay(float delay, Interp mode) const {
+        return std::min(std::max(delay, MinDelay(mode)), (float)mMaxDelay);
+    }
+    
+    inline int TapCount(Interp mode) const {
+        return (mode == Interp::Linear) ? 2 : (mode == Interp::Hermite) ? 4 : 2 * mSincHalf;
+    }
+    
+    inline const float* FrameAt(int64_t index) const {
+        return &mBuffer[(size_t)(index & mMask) * mChannels];
+    }
+    
+    // Fills the tap weights for fractional position t in [0, 1) past frame
+    // `index`; returns the offset of the first tap relative to `index`
+    inline int Weights(Interp mode, float t, float* _Nonnull weights) const {
+        switch (mode) {
+            case Interp::Linear:
+                weights[0] = 1.0f - t;
+                weights[1] = t;
+                return 0;
+            case Interp::Hermite: {
+                // 4-point, 3rd-order Hermite (Catmull-Rom)
+                float t2 = t * t;
+                float t3 = t2 * t;
+                weights[0] = -0.5f * t + t2 - 0.5f * t3;
+                weights[1] = 1.0f - 2.5f * t2 + 1.5f * t3;
+                weights[2] = 0.5f * t + 2.0f * t2 - 1.5f * t3;
+                weights[3] = -0.5f * t2 + 0.5f * t3;
+                return -1;
+            }
+            case Interp::Sinc:
+            default: {
+                // Blend the two nearest precomputed phases
+                float phase = t * kSincPhases;
+                int p = std::min((int)phase, kSincPhases - 1);
+                float blend = phase - (float)p;
+                int taps = 2 * mSincHalf;
+                const float* a = &mSincTable[(size_t)p * taps];
+                const float* b = a + taps;
+                for (int k = 0; k < taps; k++) {
+                    weights[k] = a[k] + (b[k] - a[k]) * blend;
+                }
+                return 1 - mSincHalf;
+            }
+        }
+    }
+    
+    inline void Sum(float* _Nonnull out, int64_t firstIndex, const float* _Nonnull weights, int taps) const {
+        AudioKernels::ScaleFrame(out, FrameAt(firstIndex), weights[0], mChannels);
+        for (int k = 1; k < taps; k++) {
+            AudioKernels::AccumulateFrame(out, FrameAt(firstIndex + k), weights[k], mChannels);
+        }
+    }
+    
+    // Blackman-windowed sinc, one row of 2 * halfWidth taps per phase
+    // (plus a closing row for t = 1), each row normalised to unity gain
+    inline void BuildSincTable(int halfWidth) {
+        int taps = 2 * halfWidth;
+        mSincTable.assign((size_t)(kSincPhases + 1) * taps, 0.0f);
+        
+        for (int p = 0; p <= kSincPhases; p++) {
+            double t = (double)p / kSincPhases;
+            double sum = 0.0;
+            float* row = &mSincTable[(size_t)p * taps];
+            for (int k = 0; k < taps; k++) {
+                double x = t + (halfWidth - 1) - k;      // distance from the read position
+                double sinc = (std::fabs(x) < 1e-9) ? 1.0 : std::sin(kRingPi * x) / (kRingPi * x);
+                double w = (x + halfWidth) / (2.0 * halfWidth);
+                double window = (w <= 0.0 || w >= 1.0) ? 0.0
+                              : 0.42 - 0.5 * std::cos(2.0 * kRingPi * w) + 0.08 * std::cos(4.0 * kRingPi * w);
+                row[k] = (float)(sinc * window);
+                sum += row[k];
+            }
+            for (int k = 0; k < taps; k++) {
+                row[k] = (float)(row[k] / sum);
+            }
+        }
+    }
+    
+    std::vector<float> mBuffer;
+    std::vector<float> mSincTable;
+    int mChannels{0};
+    int mMask{0};
+    int mMaxDelay{0};
+    int mMaxBlock{0};
+    int mSincHalf{8};
+    uint64_t mWriteCount{0};
+};
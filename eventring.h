@@ -0,0 +1,185 @@
+/*
+ *   The Ultimate Ring Buffer v1.2 - Sample-Accurate Event Ring
+ *   �1999-2025 SUBBAND, Inc. & Dmitry Boldyrev
+ *   
+ *   Description:    SPSC queue of frame-stamped events (MIDI, automation) for audio blocks
+ *   Updated:        Oct 18, 2026
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "audioring.h"
+
+// Events addressed to an absolute frame on an AudioRing's timeline, passed
+// from a control thread (UI, MIDI input) to the audio thread. Slots are a
+// fixed 32 bytes with the payload inline, in a power-of-two array indexed
+// by monotonic counters, so a push or pop is a copy and one atomic store.
+//
+// The producer pushes in non-decreasing frame order (an earlier frame is
+// raised to the latest one pushed and counted in Reordered()), which keeps
+// the queue sorted: the events due before a frame are always a prefix,
+// and popping them costs O(1) per event plus one check for the first event
+// that isn't due. DrainBlock() hands each due event to a callback with
+// its offset inside the current block. Late events (before the block) land
+// at offset 0.
+
+struct RingEvent {
+    static constexpr int kPayloadBytes = 20;
+    
+    uint64_t frame;                 // absolute frame the event applies at
+    uint16_t type;                  // user-defined
+    uint8_t  size;                  // payload bytes used
+    uint8_t  channel;
+    uint8_t  data[kPayloadBytes];
+    
+    // Typed view of the payload, e.g. a float parameter value
+    template <typename T>
+    inline T As() const {
+        static_assert(sizeof(T) <= kPayloadBytes && std::is_trivially_copyable_v<T>, "payload type too large");
+        T value;
+        std::memcpy(&value, data, sizeof(T));
+        return value;
+    }
+};
+static_assert(sizeof(RingEvent) == 32, "RingEvent should stay one half cache line");
+
+class EventRing {
+public:
+    explicit EventRing(int capacity = 1024) {
+        if (Init(capacity) < 0) {
+            throw std::runtime_error("EventRing initialization failed");
+        }
+    }
+    
+    inline int Init(int capacity) {
+        if (capacity <= 0) return -1;
+        int slots = 1;
+        while (slots < capacity) slots <<= 1;
+        try {
+            mSlots.reset(new RingEvent[slots]);
+        } catch (const std::bad_alloc&) {
+            RING_LOG("EventRing: allocation failed for %d events", slots);
+            return -1;
+        }
+        mMask = slots - 1;
+        mHead.store(0, std::memory_order_relaxed);
+        mTail.store(0, std::memory_order_relaxed);
+        mLastFrame = 0;
+        return 0;
+    }
+    
+    inline int Capacity() const { return mMask + 1; }
+    
+    inline int Size() const {
+        return (int)(mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire));
+    }
+    
+    // ===== PRODUCER =====
+    
+    // Queues an event; -1 if full or the payload doesn't fit
+    inline int Push(uint64_t frame, uint16_t type, const void* _Nullable payload = nullptr, int bytes = 0, uint8_t channel = 0) {
+        if (bytes < 0 || bytes > RingEvent::kPayloadBytes || (bytes > 0 && !payload)) return -1;
+        
+        uint64_t tail = mTail.load(std::memory_order_relaxed);
+        if (tail - mHead.load(std::memory_order_acquire) > (uint64_t)mMask) {
+            mOverflows.store(mOverflows.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return -1;
+        }
+        
+        if (frame < mLastFrame) {
+            frame = mLastFrame;
+            mReordered.store(mReordered.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        mLastFrame = frame;
+        
+        RingEvent& event = mSlots[tail & mMask];
+        event.frame = frame;
+        event.type = type;
+        event.size = (uint8_t)bytes;
+        event.channel = channel;
+        if (bytes > 0) std::memcpy(event.data, payload, bytes);
+        
+        mTail.store(tail + 1, std::memory_order_release);
+        return 0;
+    }
+    
+    template <typename T>
+    inline int PushValue(uint64_t frame, uint16_t type, const T& value, uint8_t channel = 0) {
+        static_assert(std::is_trivially_copyable_v<T>, "payload must be trivially copyable");
+        return Push(frame, type, &value, (int)sizeof(T), channel);
+    }
+    
+    // ===== CONSUMER =====
+    
+    // The oldest queued event if it is due before endFrame, else null
+    inline const RingEvent* _Nullable PeekDue(uint64_t endFrame) const {
+        uint64_t head = mHead.load(std::memory_order_relaxed);
+        if (head == mTail.load(std::memory_order_acquire)) return nullptr;
+        const RingEvent& event = mSlots[head & mMask];
+        return event.frame < endFrame ? &event : nullptr;
+    }
+    
+    inline void Pop() {
+        mHead.store(mHead.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    
+    // Copies out up to maxEvents events due before endFrame; returns count
+    inline int PopDue(uint64_t endFrame, RingEvent* _Nonnull out, int maxEvents) {
+        int count = 0;
+        DrainDue(endFrame, maxEvents, [&](const RingEvent& event) { out[count++] = event; });
+        return count;
+    }
+    
+    // Calls fn(event, offset) for each event due in [blockStart, blockStart
+    // + frames), offset being its frame within the block; returns count
+    template <typename Fn>
+    inline int DrainBlock(uint64_t blockStart, int frames, Fn&& fn) {
+        return DrainDue(blockStart + (uint64_t)frames, INT32_MAX, [&](const RingEvent& event) {
+            fn(event, event.frame > blockStart ? (int)(event.frame - blockStart) : 0);
+        });
+    }
+    
+    // Block starting at the ring's read head: call before reading the block
+    template <typename SampleT, typename Fn>
+    inline int DrainBlock(const AudioRing<SampleT>& ring, int frames, Fn&& fn) {
+        return DrainBlock(ring.FramesRead(), frames, std::forward<Fn>(fn));
+    }
+    
+    // ===== METRICS =====
+    
+    inline uint64_t Overflows() const { return mOverflows.load(std::memory_order_relaxed); }
+    inline uint64_t Reordered() const { return mReordered.load(std::memory_order_relaxed); }
+    
+    EventRing(const EventRing&) = delete;
+    EventRing& operator=(const EventRing&) = delete;
+    
+private:
+    // Visits due events in place, releasing them with a single head store
+    template <typename Fn>
+    inline int DrainDue(uint64_t endFrame, int maxEvents, Fn&& fn) {
+        uint64_t head = mHead.load(std::memory_order_relaxed);
+        uint64_t tail = mTail.load(std::memory_order_acquire);
+        int count = 0;
+        while (head != tail && count < maxEvents) {
+            const RingEvent& event = mSlots[head & mMask];
+            if (event.frame >= endFrame) break;
+            fn(event);
+            head++;
+            count++;
+        }
+        if (count > 0) {
+            mHead.store(head, std::memory_order_release);
+        }
+        return count;
+    }
+    
+    std::unique_ptr<RingEvent[]> mSlots;
+    int mMask{0};
+    alignas(64) std::atomic<uint64_t> mHead{0};     // consumer
+    alignas(64) std::atomic<uint64_t> mTail{0};     // producer
+    uint64_t mLastFrame{0};                         // producer only
+    std::atomic<uint64_t> mOverflows{0};
+    std::atomic<uint64_t> mReordered{0};
+};
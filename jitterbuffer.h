@@ -0,0 +1,364 @@
+/*
+ *   The Ultimate Ring Buffer v1.2 - Jitter Buffer
+ *   �1999-2025 SUBBAND, Inc. & Dmitry Boldyrev
+ *   
+ *   Description:    Sequence-ordered audio packet playout with adaptive depth and loss concealment
+ *   Updated:        Oct 18, 2026
+ */
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include "ringbuffer.h"
+#include "audiokernels.h"
+
+// Receive side of a packetised audio stream. The network thread Put()s each
+// packet as a framed record into a transport RingBuffer (stamped on commit,
+// which doubles as the arrival time); the audio thread drains that ring at
+// the top of every Read(), files packets into a reorder window keyed by
+// sequence number, and plays them out in order.
+//
+// Target depth adapts to the RFC 3550 interarrival jitter estimate: playout
+// starts (and restarts after an underrun) once the window holds
+// TargetDepth() packets, and a window grown well past target after a burst
+// is trimmed by discarding the oldest packet. Missing packets are concealed
+// by repeating the last good one with a linear fade toward silence over
+// maxConceal packets; the next real packet fades back in. Output is
+// silent while the stream's first packets buffer, and the first one played
+// fades in from there.
+//
+// Sequence arithmetic is modulo 2^32. Counters may be read from any thread.
+
+struct JitterConfig {
+    int channels = 2;
+    int packetFrames = 480;         // frames per packet, fixed for the stream
+    int sampleRate = 48000;         // timestamp units per second
+    int slots = 64;                 // reorder window in packets, power of two
+    int minDepth = 2;               // target depth bounds, in packets
+    int maxDepth = 32;
+    double jitterMultiple = 3.0;    // target headroom in units of the jitter estimate
+    int maxConceal = 4;             // packets of faded repeat before silence
+};
+
+struct JitterPacketHeader {
+    uint32_t sequence;
+    uint32_t timestamp;             // in sample frames, RTP style
+};
+
+class JitterBuffer {
+public:
+    explicit JitterBuffer(const JitterConfig& config = {}) {
+        if (Init(config) < 0) {
+            throw std::runtime_error("JitterBuffer initialization failed");
+        }
+    }
+    
+    inline int Init(const JitterConfig& config) {
+        if (config.channels <= 0 || config.packetFrames <= 0 || config.sampleRate <= 0 ||
+            config.slots <= 0 || (config.slots & (config.slots - 1)) != 0 ||
+            config.minDepth <= 0 || config.maxDepth < config.minDepth || config.maxDepth >= config.slots) {
+            return -1;
+        }
+        
+        mConfig = config;
+        mPacketSamples = config.packetFrames * config.channels;
+        int recordBytes = RingBuffer::kRecordHeaderBytes + PacketBytes();
+        if (mQueue.Init(2 * config.slots * recordBytes) < 0) return -1;
+        try {
+            mSlotData.assign((size_t)config.slots * mPacketSamples, 0.0f);
+            mSlots.assign((size_t)config.slots, Slot{});
+            mLast.assign((size_t)mPacketSamples, 0.0f);
+            mOut.assign((size_t)mPacketSamples, 0.0f);
+        } catch (const std::bad_alloc&) {
+            RING_LOG("JitterBuffer: allocation failed for %d slots", config.slots);
+            return -1;
+        }
+        mTargetDepth = config.minDepth;
+        mOutOffset = config.packetFrames;
+        return 0;
+    }
+    
+    // ===== NETWORK SIDE =====
+    
+    // Queues one packet of packetFrames interleaved frames; -1 if the
+    // transport ring is full (counted as lost once its gap is played)
+    inline int Put(uint32_t sequence, uint32_t timestamp, const float* _Nonnull samples) {
+        uint8_t* payload = mQueue.BeginRecord(PacketBytes());
+        if (!payload) return -1;
+        
+        JitterPacketHeader header{sequence, timestamp};
+        std::memcpy(payload, &header, sizeof(header));
+        std::memcpy(payload + sizeof(header), samples, (size_t)mPacketSamples * sizeof(float));
+        return mQueue.CommitRecord(PacketBytes()) < 0 ? -1 : 0;
+    }
+    
+    // ===== AUDIO SIDE =====
+    
+    // Always produces `frames` interleaved frames (audio, concealment or silence)
+    inline int Read(float* _Nonnull out, int frames) {
+        Drain();
+        
+        int produced = 0;
+        while (produced < frames) {
+            if (mOutOffset == mConfig.packetFrames) {
+                NextPacket();
+                mOutOffset = 0;
+            }
+            int run = std::min(frames - produced, mConfig.packetFrames - mOutOffset);
+            std::memcpy(out + (size_t)produced * mConfig.channels,
+                        &mOut[(size_t)mOutOffset * mConfig.channels],
+                        (size_t)run * mConfig.channels * sizeof(float));
+            produced += run;
+            mOutOffset += run;
+        }
+        return frames;
+    }
+    
+    // Packets spanned by the reorder window, gaps included
+    inline int Depth() const {
+        if (!mStarted) return 0;
+        int32_t span = (int32_t)(mHighestSeq - mNextSeq) + 1;
+        return std::max(span, 0);
+    }
+    
+    inline int TargetDepth() const { return mTargetDepth; }
+    
+    // Interarrival jitter estimate in frames
+    inline double Jitter() const { return mJitter; }
+    
+    // ===== METRICS =====
+    
+    inline uint64_t Received() const { return mReceived.load(std::memory_order_relaxed); }
+    inline uint64_t Underruns() const { return mUnderruns.load(std::memory_order_relaxed); }
+    inline uint64_t Late() const { return mLate.load(std::memory_order_relaxed); }
+    inline uint64_t Lost() const { return mLost.load(std::memory_order_relaxed); }
+    inline uint64_t Concealed() const { return mConcealed.load(std::memory_order_relaxed); }
+    inline uint64_t Discarded() const { return mDiscarded.load(std::memory_order_relaxed); }
+    inline uint64_t Restarts() const { return mRestarts.load(std::memory_order_relaxed); }
+    
+    JitterBuffer(const JitterBuffer&) = delete;
+    JitterBuffer& operator=(const JitterBuffer&) = delete;
+    
+private:
+    struct Slot {
+        bool valid{false};
+        uint32_t sequence{0};
+    };
+    
+    inline int PacketBytes() const {
+        return (int)sizeof(JitterPacketHeader) + mPacketSamples * (int)sizeof(float);
+    }
+    
+    inline float* SlotSamples(uint32_t sequence) {
+        return &mSlotData[(size_t)(sequence & (uint32_t)(mConfig.slots - 1)) * mPacketSamples];
+    }
+    
+    inline Slot& SlotFor(uint32_t sequence) {
+        return mSlots[sequence & (uint32_t)(mConfig.slots - 1)];
+    }
+    
+    // Moves every queued packet into the reorder window
+    inline void Drain() {
+        RingBuffer::RecordHeader record;
+        while (mQueue.PeekRecordHeader(record)) {
+            const uint8_t* payload = mQueue.PeekRecordView(record);
+            if (payload && (int)record.size == PacketBytes()) {
+                JitterPacketHeader header;
+                std::memcpy(&header, payload, sizeof(header));
+                Accept(header, record.stamp, payload + sizeof(header));
+            }
+            mQueue.SkipRecord();
+        }
+    }
+    
+    inline void Accept(const JitterPacketHeader& header, uint64_t arrivalTicks, const uint8_t* _Nonnull samples) {
+        Bump(mReceived);
+        UpdateJitter(header.timestamp, arrivalTicks);
+        
+        if (!mStarted) {
+            mStarted = true;
+            mNextSeq = header.sequence;
+            mHighestSeq = header.sequence;
+        }
+        
+        int32_t ahead = (int32_t)(header.sequence - mNextSeq);
+        if (ahead < 0) {
+            // Before the stream's first packet plays, an earlier packet simply
+            // extends the window; once anything has played it is late
+            if (!mEverPlayed && (int32_t)(mHighestSeq - header.sequence) < mConfig.slots) {
+                mNextSeq = header.sequence;
+            } else {
+                Bump(mLate);
+                return;
+            }
+        } else if (ahead >= mConfig.slots) {
+            Resync(header.sequence);
+        }
+        
+        Slot& slot = SlotFor(header.sequence);
+        if (slot.valid && slot.sequence == header.sequence) return;     // duplicate
+        
+        slot.valid = true;
+        slot.sequence = header.sequence;
+        std::memcpy(SlotSamples(header.sequence), samples, (size_t)mPacketSamples * sizeof(float));
+        if ((int32_t)(header.sequence - mHighestSeq) > 0) {
+            mHighestSeq = header.sequence;
+        }
+    }
+    
+    // A packet beyond the window: slide forward, writing off what's skipped
+    // (gaps as lost, packets that arrived but never played as discarded).
+    // A jump of more than a whole window is treated as a stream restart:
+    // counted in Restarts(), not as loss, and buffered afresh.
+    inline void Resync(uint32_t sequence) {
+        uint32_t newNext = sequence - (uint32_t)(mConfig.slots - 1);
+        int32_t skipped = (int32_t)(newNext - mNextSeq);
+        if (skipped >= mConfig.slots) {
+            for (Slot& slot : mSlots) slot.valid = false;
+            Bump(mRestarts);
+            newNext = sequence;
+            mHighestSeq = sequence;
+            mPlaying = false;
+            mEverPlayed = false;
+        } else {
+            for (; mNextSeq != newNext; mNextSeq++) {
+                Slot& slot = SlotFor(mNextSeq);
+                Bump((slot.valid && slot.sequence == mNextSeq) ? mDiscarded : mLost);
+                slot.valid = false;
+            }
+        }
+        mNextSeq = newNext;
+        RING_LOG("JitterBuffer: resync to sequence %u, skipped %d", newNext, skipped);
+    }
+    
+    // RFC 3550: J += (|D| - J) / 16, D = arrival spacing minus timestamp spacing
+    inline void UpdateJitter(uint32_t timestamp, uint64_t arrivalTicks) {
+        double arrival = (double)RingClock::ToNanos(arrivalTicks) * 1e-9 * mConfig.sampleRate;
+        if (mHaveArrival) {
+            double transit = (arrival - mLastArrival) - (double)(int32_t)(timestamp - mLastTimestamp);
+            mJitter += (std::fabs(transit) - mJitter) / 16.0;
+            int depth = (int)std::ceil(mJitter * mConfig.jitterMultiple / mConfig.packetFrames) + 1;
+            mTargetDepth = std::clamp(depth, mConfig.minDepth, mConfig.maxDepth);
+        }
+        mHaveArrival = true;
+        mLastArrival = arrival;
+        mLastTimestamp = timestamp;
+    }
+    
+    // Renders the next packet's worth of output into mOut
+    inline void NextPacket() {
+        if (mPlaying && Depth() > 2 * mTargetDepth) {
+            Trim();
+        }
+        if (!mPlaying && mStarted && Depth() >= mTargetDepth) {
+            mPlaying = true;
+            mEverPlayed = true;
+        }
+        
+        if (mPlaying) {
+            Slot& slot = SlotFor(mNextSeq);
+            if (slot.valid && slot.sequence == mNextSeq) {
+                slot.valid = false;
+                std::memcpy(mLast.data(), SlotSamples(mNextSeq), (size_t)mPacketSamples * sizeof(float));
+                mNextSeq++;
+                mConcealRun = 0;
+                Render(1.0f);
+                return;
+            }
+            
+            if (Depth() > 1) {
+                // Gap with later packets already here: this one is lost
+                Bump(mLost);
+                slot.valid = false;
+                mNextSeq++;
+            } else {
+                // Ran dry: conceal while rebuffering up to target
+                Bump(mUnderruns);
+                mPlaying = false;
+            }
+        }
+        
+        if (!mEverPlayed) {
+            // Still buffering the stream's first packets: silence, not concealment
+            Render(0.0f);
+            return;
+        }
+        if (mGain > 0.0f) {
+            Bump(mConcealed);
+            mConcealRun++;
+        }
+        Render(std::max(0.0f, 1.0f - (float)mConcealRun / (float)mConfig.maxConceal));
+    }
+    
+    // Drops the oldest packet to pull latency back toward target
+    inline void Trim() {
+        Slot& slot = SlotFor(mNextSeq);
+        if (!(slot.valid && slot.sequence == mNextSeq)) Bump(mLost);
+        slot.valid = false;
+        mNextSeq++;
+        Bump(mDiscarded);
+    }
+    
+    // mLast ramped linearly from the previous packet's end gain to `gain`
+    inline void Render(float gain) {
+        float start = mGain;
+        mGain = gain;
+        int frames = mConfig.packetFrames;
+        int channels = mConfig.channels;
+        
+        if (start == gain) {
+            if (gain == 1.0f) {
+                std::memcpy(mOut.data(), mLast.data(), (size_t)mPacketSamples * sizeof(float));
+            } else if (gain == 0.0f) {
+                std::fill(mOut.begin(), mOut.end(), 0.0f);
+            } else {
+                AudioKernels::ScaleFrame(mOut.data(), mLast.data(), gain, mPacketSamples);
+            }
+            return;
+        }
+        
+        float step = (gain - start) / (float)frames;
+        for (int i = 0; i < frames; i++) {
+            AudioKernels::ScaleFrame(&mOut[(size_t)i * channels], &mLast[(size_t)i * channels],
+                                     start + step * (float)(i + 1), channels);
+        }
+    }
+    
+    // Single writer per counter
+    static inline void Bump(std::atomic<uint64_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    
+    JitterConfig mConfig;
+    RingBuffer mQueue;
+    int mPacketSamples{0};
+    std::vector<float> mSlotData;       // one packet per slot, indexed by sequence mod slots
+    std::vector<Slot> mSlots;
+    std::vector<float> mLast;           // last good packet, source for concealment
+    std::vector<float> mOut;            // current packet's rendered output
+    int mOutOffset{0};                  // frames of mOut already delivered
+    
+    bool mStarted{false};
+    bool mPlaying{false};
+    bool mEverPlayed{false};            // playout has started since the last (re)start
+    uint32_t mNextSeq{0};
+    uint32_t mHighestSeq{0};
+    int mConcealRun{0};
+    float mGain{0.0f};
+    
+    bool mHaveArrival{false};
+    double mLastArrival{0.0};
+    uint32_t mLastTimestamp{0};
+    double mJitter{0.0};
+    int mTargetDepth{2};
+    
+    std::atomic<uint64_t> mReceived{0};
+    std::atomic<uint64_t> mUnderruns{0};
+    std::atomic<uint64_t> mLate{0};
+    std::atomic<uint64_t> mLost{0};
+    std::atomic<uint64_t> mConcealed{0};
+    std::atomic<uint64_t> mDiscarded{0};
+    std::atomic<uint64_t> mRestarts{0};
+};
@@ -0,0 +1,229 @@
+/*
+ *   The Ultimate Ring Buffer v1.2 - Waveform Overview Pyramid
+ *   �1999-2025 SUBBAND, Inc. & Dmitry Boldyrev
+ *   
+ *   Description:    Incremental multi-resolution min/max buckets for waveform display
+ *   Updated:        Oct 18, 2026
+ */
+
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <memory>
+
+#include "audiokernels.h"
+
+// Min/max summaries of a stream at several resolutions, built as frames are
+// pushed. Level 0 holds one bucket per 2^baseShift frames; each level above
+// merges two buckets of the one below, so level l covers 2^(baseShift + l)
+// frames per bucket. Every level is its own small power-of-two ring sized to
+// retain at least retainFrames of history.
+//
+// Query() draws a range of the stream's absolute frame timeline (the
+// producer's FramesWritten()) into `pixels` columns by picking the coarsest
+// level whose buckets still fit in a column, so each column merges at most
+// a handful of buckets: O(pixels) whatever the zoom. Only completed
+// buckets are visible; the newest partial level-0 bucket appears once it
+// fills. originFrame is the timeline position of the first pushed frame,
+// for pyramids started mid-stream; buckets are aligned to it.
+//
+// Push() is producer only. Query() may run on any thread: bucket rings are
+// read optimistically and columns whose buckets were overwritten mid-read
+// are reported as empty. Each bucket is published as soon as it is stored,
+// and every level ring keeps one slot beyond the readable window, so the
+// slot being written is never one a reader treats as valid; a reader that
+// sees the count move past its first bucket after the copy discards it.
+
+class OverviewPyramid {
+public:
+    OverviewPyramid(int channels, int baseShift, int levels, int retainFrames, uint64_t originFrame = 0) {
+        if (Init(channels, baseShift, levels, retainFrames, originFrame) < 0) {
+            throw std::runtime_error("OverviewPyramid initialization failed");
+        }
+    }
+    
+    inline int Init(int channels, int baseShift, int levels, int retainFrames, uint64_t originFrame = 0) {
+        if (channels <= 0 || baseShift < 0 || levels <= 0 || baseShift + levels > 40 || retainFrames <= 0) return -1;
+        
+        mOrigin = originFrame;
+        mChannels = channels;
+        mBaseShift = baseShift;
+        mLevelCount = levels;
+        try {
+            mLevels.reset(new Level[levels]);
+            for (int l = 0; l < levels; l++) {
+                uint64_t buckets = ((uint64_t)retainFrames >> (baseShift + l)) + 2;
+                int capacity = 2;
+                while ((uint64_t)capacity < buckets) capacity <<= 1;
+                mLevels[l].mask = capacity - 1;
+                mLevels[l].minMax.reset(new float[(size_t)capacity * channels * 2]());
+            }
+            mAccum.reset(new float[(size_t)channels * 2]);
+        } catch (const std::bad_alloc&) {
+            RING_LOG("OverviewPyramid: allocation failed for %d levels x %d", levels, channels);
+            return -1;
+        }
+        ResetAccum();
+        return 0;
+    }
+    
+    inline int Levels() const { return mLevelCount; }
+    
+    inline uint64_t BucketFrames(int level) const {
+        return (uint64_t)1 << (mBaseShift + level);
+    }
+    
+    // Stream position up to which completed level-0 buckets reach
+    inline uint64_t CompletedFrames() const {
+        return mOrigin + (mLevels[0].completed.load(std::memory_order_acquire) << mBaseShift);
+    }
+    
+    template <typename SampleT>
+    inline void Push(const SampleT* _Nonnull data, int frames) {
+        int bucketFrames = 1 << mBaseShift;
+        for (int f = 0; f < frames; f++) {
+            const SampleT* frame = data + (size_t)f * mChannels;
+            for (int c = 0; c < mChannels; c++) {
+                float x = AudioKernels::LoadSample(frame + c);
+                mAccum[2 * c] = std::min(mAccum[2 * c], x);
+                mAccum[2 * c + 1] = std::max(mAccum[2 * c + 1], x);
+            }
+            if (++mAccumFrames == bucketFrames) {
+                CompleteBucket();
+            }
+        }
+    }
+    
+    // Fills mins[p]/maxs[p] for `pixels` equal columns of frames
+    // [startFrame, endFrame). Returns the number of columns with data;
+    // columns outside retained, completed history get 0/0.
+    inline int Query(int channel, uint64_t startFrame, uint64_t endFrame, int pixels,
+                     float* _Nonnull mins, float* _Nonnull maxs) const {
+        if (pixels <= 0 || endFrame <= startFrame || channel < 0 || channel >= mChannels) return 0;
+        
+        double span = (double)(endFrame - startFrame) / pixels;
+        int level = 0;
+        while (level + 1 < mLevelCount && (double)BucketFrames(level + 1) <= span) {
+            level++;
+        }
+        
+        int filled = 0;
+        for (int p = 0; p < pixels; p++) {
+            uint64_t from = startFrame + (uint64_t)(span * p);
+            uint64_t to = std::max(from + 1, startFrame + (uint64_t)(span * (p + 1)));
+            
+            // Coarse buckets first; the newest part of the column that the
+            // coarse level hasn't merged yet comes from successively finer
+            // levels (at most one or two buckets each). Buckets are counted
+            // from mOrigin; anything before it was never pushed.
+            float lo = std::numeric_limits<float>::infinity();
+            float hi = -lo;
+            uint64_t covered = std::max(from, mOrigin) - mOrigin;
+            uint64_t end = std::max(to, mOrigin) - mOrigin;
+            for (int l = level; l >= 0 && covered < end; l--) {
+                covered = MergeRange(l, channel, covered, end, lo, hi);
+            }
+            
+            if (lo <= hi) {
+                mins[p] = lo;
+                maxs[p] = hi;
+                filled++;
+            } else {
+                mins[p] = maxs[p] = 0.0f;
+            }
+        }
+        return filled;
+    }
+    
+    OverviewPyramid(const OverviewPyramid&) = delete;
+    OverviewPyramid& operator=(const OverviewPyramid&) = delete;
+    
+private:
+    struct Level {
+        std::unique_ptr<float[]> minMax;        // [bucket & mask][channel][min, max]
+        int mask{0};
+        uint64_t pending{0};                    // buckets written, producer view
+        std::atomic<uint64_t> completed{0};     // buckets published to readers
+    };
+    
+    // Merges level `level` buckets overlapping [from, to) into lo/hi, up to
+    // the last completed one; returns the frame where coverage stopped.
+    // Buckets overwritten during the read poison the result.
+    inline uint64_t MergeRange(int level, int channel, uint64_t from, uint64_t to, float& lo, float& hi) const {
+        const Level& lv = mLevels[level];
+        int shift = mBaseShift + level;
+        uint64_t completed = lv.completed.load(std::memory_order_acquire);
+        if (completed == 0) return from;
+        
+        uint64_t oldest = completed > (uint64_t)lv.mask ? completed - lv.mask : 0;
+        uint64_t first = std::max(from >> shift, oldest);
+        uint64_t last = std::min((to - 1) >> shift, completed - 1);
+        if (first > last) return from;
+        
+        for (uint64_t b = first; b <= last; b++) {
+            const float* bucket = &lv.minMax[((size_t)(b & lv.mask) * mChannels + channel) * 2];
+            lo = std::min(lo, bucket[0]);
+            hi = std::max(hi, bucket[1]);
+        }
+        
+        // Validate after the copy: fails if the producer reached our slots meanwhile
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t now = lv.completed.load(std::memory_order_relaxed);
+        if (now > (uint64_t)lv.mask && first < now - lv.mask) {
+            lo = std::numeric_limits<float>::infinity();
+            hi = -lo;
+            return to;
+        }
+        return (last + 1) << shift;
+    }
+    
+    inline void ResetAccum() {
+        for (int c = 0; c < mChannels; c++) {
+            mAccum[2 * c] = std::numeric_limits<float>::infinity();
+            mAccum[2 * c + 1] = -std::numeric_limits<float>::infinity();
+        }
+        mAccumFrames = 0;
+    }
+    
+    // Stores the level-0 bucket, then merges pairs upward while they complete
+    inline void CompleteBucket() {
+        StoreBucket(0, mAccum.get());
+        ResetAccum();
+        
+        for (int l = 1; l < mLevelCount; l++) {
+            const Level& below = mLevels[l - 1];
+            if (below.pending & 1) break;
+            
+            const float* a = &below.minMax[(size_t)((below.pending - 2) & below.mask) * mChannels * 2];
+            const float* b = &below.minMax[(size_t)((below.pending - 1) & below.mask) * mChannels * 2];
+            float* merged = &mLevels[l].minMax[(size_t)(mLevels[l].pending & mLevels[l].mask) * mChannels * 2];
+            for (int c = 0; c < mChannels; c++) {
+                merged[2 * c] = std::min(a[2 * c], b[2 * c]);
+                merged[2 * c + 1] = std::max(a[2 * c + 1], b[2 * c + 1]);
+            }
+            PublishBucket(mLevels[l]);
+        }
+    }
+    
+    inline void StoreBucket(int level, const float* _Nonnull minMax) {
+        Level& lv = mLevels[level];
+        std::memcpy(&lv.minMax[(size_t)(lv.pending & lv.mask) * mChannels * 2], minMax, (size_t)mChannels * 2 * sizeof(float));
+        PublishBucket(lv);
+    }
+    
+    // Publishes each bucket before the next slot is touched; a batch publish
+    // would let one Push() overwrite a slot readers still consider valid
+    static inline void PublishBucket(Level& lv) {
+        lv.pending++;
+        lv.completed.store(lv.pending, std::memory_order_release);
+    }
+    
+    uint64_t mOrigin{0};                // stream frame of the first pushed frame
+    int mChannels{0};
+    int mBaseShift{0};
+    int mLevelCount{0};
+    std::unique_ptr<Level[]> mLevels;
+    std::unique_ptr<float[]> mAccum;    // level-0 bucket in progress: min, max per channel
+    int mAccumFrames{0};
+};
@@ -0,0 +1,211 @@
+/*
+ *   The Ultimate Ring Buffer v1.2 - Drift Resampler
+ *   �1999-2025 SUBBAND, Inc. & Dmitry Boldyrev
+ *   
+ *   Description:    Fill-level controlled polyphase resampling consumer for AudioRing
+ *   Updated:        Oct 18, 2026
+ */
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include "audioring.h"
+
+// Consumer stage for a producer and consumer on independent clocks. Instead
+// of letting the ring drift until it over/underruns (and resyncing with
+// Empty()), the reader resamples by a ratio just off 1.0 chosen by a PI
+// controller that holds the ring's smoothed fill level at a target latency.
+//
+// The resampler is a windowed-sinc polyphase FIR: kPhases rows of kTaps
+// coefficients, blended between the two nearest rows for the exact phase.
+// Input is pulled from the ring deinterleaved into per-channel history so
+// every output sample is one SIMD dot product. All storage is sized in
+// Init(); Read() never allocates. Read() runs on the consumer thread only.
+
+struct DriftConfig {
+    int targetFrames = 1024;        // fill level to hold
+    int maxBlockFrames = 4096;      // largest Read() request
+    double maxPpm = 1000.0;         // ratio correction limit
+    double kp = 6e-6;               // proportional gain, ratio per frame of error
+    double ki = 2e-11;              // integral gain; with kp, ~0.7 damping
+    double smoothing = 0.05;        // one-pole fill filter coefficient per Read()
+};
+
+class DriftResampler {
+public:
+    static constexpr int kTaps = 32;
+    static constexpr int kPhases = 256;
+    
+    explicit DriftResampler(AudioRing<float>& ring, const DriftConfig& config = {}) : mRing(ring) {
+        if (Init(config) < 0) {
+            throw std::runtime_error("DriftResampler initialization failed");
+        }
+    }
+    
+    inline int Init(const DriftConfig& config) {
+        if (config.targetFrames <= 0 || config.maxBlockFrames <= 0 || config.maxPpm <= 0.0) return -1;
+        
+        mConfig = config;
+        mChannels = mRing.Channels();
+        double maxRatio = 1.0 + config.maxPpm * 1e-6;
+        mHistoryCapacity = (int)std::ceil(config.maxBlockFrames * maxRatio) + kTaps + 2;
+        try {
+            mHistory.assign((size_t)mHistoryCapacity * mChannels, 0.0f);
+            mChannelPtrs.assign((size_t)mChannels, nullptr);
+            BuildTable();
+        } catch (const std::bad_alloc&) {
+            RING_LOG("DriftResampler: allocation failed for %d x %d", mHistoryCapacity, mChannels);
+            return -1;
+        }
+        Reset();
+        return 0;
+    }
+    
+    // Drops buffered input and restarts the controller at ratio 1.0
+    inline void Reset() {
+        std::fill(mHistory.begin(), mHistory.end(), 0.0f);
+        mHistoryFrames = kTaps;         // zero-primed so the first output has full support
+        mTime = kTaps / 2 - 1;
+        mIntegral = 0.0;
+        mRatio = 1.0;
+        mFillAverage = mConfig.targetFrames;
+    }
+    
+    // Produces `frames` interleaved output frames; returns frames produced
+    inline int Read(float* _Nonnull out, int frames) {
+        frames = std::min(frames, mConfig.maxBlockFrames);
+        if (frames <= 0) return 0;
+        
+        UpdateRatio(frames);
+        Fill(frames);
+        
+        float weights[kTaps];
+        for (int i = 0; i < frames; i++) {
+            int index = (int)mTime;
+            PhaseWeights((float)(mTime - index), weights);
+            const float* history = &mHistory[(size_t)(index - kTaps / 2 + 1)];
+            for (int c = 0; c < mChannels; c++) {
+                out[(size_t)i * mChannels + c] = AudioKernels::Dot(weights, history + (size_t)c * mHistoryCapacity, kTaps);
+            }
+            mTime += mRatio;
+        }
+        Compact();
+        return frames;
+    }
+    
+    // Input frames consumed per output frame
+    inline double Ratio() const { return mRatio; }
+    
+    // Smoothed fill level (ring plus buffered history) the controller sees
+    inline double FillLevel() const { return mFillAverage; }
+    
+    // Input frames zero-filled because the ring ran dry
+    inline uint64_t Underruns() const { return mUnderruns; }
+    
+    DriftResampler(const DriftResampler&) = delete;
+    DriftResampler& operator=(const DriftResampler&) = delete;
+    
+private:
+    // PI step on the smoothed fill error; the integral is clamped to the
+    // ppm range so it can't wind up during a long underrun
+    inline void UpdateRatio(int frames) {
+        double fill = mRing.UsedFrames() + (mHistoryFrames - mTime);
+        mFillAverage += mConfig.smoothing * (fill - mFillAverage);
+        
+        double error = mFillAverage - mConfig.targetFrames;
+        double limit = mConfig.maxPpm * 1e-6;
+        mIntegral += error * frames;
+        if (mConfig.ki > 0.0) {
+            mIntegral = std::clamp(mIntegral, -limit / mConfig.ki, limit / mConfig.ki);
+        }
+        double correction = mConfig.kp * error + mConfig.ki * mIntegral;
+        mRatio = 1.0 + std::clamp(correction, -limit, limit);
+    }
+    
+    // Pulls enough input for `frames` outputs at the current ratio
+    inline void Fill(int frames) {
+        double end = mTime + mRatio * (frames - 1);
+        int needed = (int)end + kTaps / 2 + 1 - mHistoryFrames;
+        needed = std::min(needed, mHistoryCapacity - mHistoryFrames);
+        if (needed <= 0) return;
+        
+        for (int c = 0; c < mChannels; c++) {
+            mChannelPtrs[c] = &mHistory[(size_t)c * mHistoryCapacity + mHistoryFrames];
+        }
+        int got = mRing.ReadPlanar(mChannelPtrs.data(), std::min(needed, mRing.UsedFrames()));
+        if (got < needed) {
+            for (int c = 0; c < mChannels; c++) {
+                std::fill_n(mChannelPtrs[c] + got, needed - got, 0.0f);
+            }
+            mUnderruns += (uint64_t)(needed - got);
+        }
+        mHistoryFrames += needed;
+    }
+    
+    // Slides history down so the oldest frame still in filter support is at 0
+    inline void Compact() {
+        int drop = (int)mTime - (kTaps / 2 - 1);
+        if (drop <= 0) return;
+        
+        drop = std::min(drop, mHistoryFrames);
+        for (int c = 0; c < mChannels; c++) {
+            float* channel = &mHistory[(size_t)c * mHistoryCapacity];
+            std::memmove(channel, channel + drop, (size_t)(mHistoryFrames - drop) * sizeof(float));
+        }
+        mHistoryFrames -= drop;
+        mTime -= drop;
+    }
+    
+    inline void PhaseWeights(float t, float* _Nonnull weights) const {
+        float phase = t * kPhases;
+        int p = std::min((int)phase, kPhases - 1);
+        float blend = phase - (float)p;
+        const float* a = &mTable[(size_t)p * kTaps];
+        const float* b = a + kTaps;
+        for (int k = 0; k < kTaps; k++) {
+            weights[k] = a[k] + (b[k] - a[k]) * blend;
+        }
+    }
+    
+    // Blackman-windowed sinc at 0.9 x Nyquist; ratios stay within a few
+    // hundred ppm of 1.0, so no per-ratio cutoff adjustment is needed
+    inline void BuildTable() {
+        constexpr double kCutoff = 0.9;
+        mTable.assign((size_t)(kPhases + 1) * kTaps, 0.0f);
+        
+        for (int p = 0; p <= kPhases; p++) {
+            double t = (double)p / kPhases;
+            double sum = 0.0;
+            float* row = &mTable[(size_t)p * kTaps];
+            for (int k = 0; k < kTaps; k++) {
+                double x = t + (kTaps / 2 - 1) - k;
+                double arg = kRingPi * kCutoff * x;
+                double sinc = (std::fabs(x) < 1e-9) ? 1.0 : std::sin(arg) / arg;
+                double w = (x + kTaps / 2) / (double)kTaps;
+                double window = (w <= 0.0 || w >= 1.0) ? 0.0
+                              : 0.42 - 0.5 * std::cos(2.0 * kRingPi * w) + 0.08 * std::cos(4.0 * kRingPi * w);
+                row[k] = (float)(sinc * window);
+                sum += row[k];
+            }
+            for (int k = 0; k < kTaps; k++) {
+                row[k] = (float)(row[k] / sum);
+            }
+        }
+    }
+    
+    AudioRing<float>& mRing;
+    DriftConfig mConfig;
+    int mChannels{0};
+    int mHistoryCapacity{0};
+    int mHistoryFrames{0};
+    double mTime{0.0};                  // read position in history, fractional frames
+    double mRatio{1.0};
+    double mIntegral{0.0};
+    double mFillAverage{0.0};
+    uint64_t mUnderruns{0};
+    std::vector<float> mHistory;        // planar: one mHistoryCapacity run per channel
+    std::vector<float*> mChannelPtrs;
+    std::vector<float> mTable;
+};
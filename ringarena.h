@@ -0,0 +1,173 @@
+/*
+ *   The Ultimate Ring Buffer v1.2 - FIFO Arena
+ *   �1999-2025 SUBBAND, Inc. & Dmitry Boldyrev
+ *   
+ *   Description:    Ring-backed FIFO arena allocator with std::pmr::memory_resource
+ *   Updated:        Oct 18, 2026
+ */
+
+#pragma once
+
+#include <memory_resource>
+#include <new>
+
+#include "ringbuffer.h"
+
+// Bump-pointer allocator over a fixed ring of memory for objects that die
+// roughly in the order they were born (in-flight packets, pending I/O).
+// Allocation advances the head; freeing marks a block and advances the tail
+// over every leading freed block, so an out-of-order free simply holds the
+// tail until the older blocks are released. A block that doesn't fit before
+// the end of the buffer leaves a skip block there and starts at offset 0.
+//
+// Head and tail are monotonic byte counters, like the RingBuffer read and
+// write counts, and each has a single writer: exactly one thread allocates
+// and exactly one thread (it may be the same one) frees. Free() advances the
+// tail with a plain load and store, so two threads freeing concurrently -
+// including a pmr container deallocating on the allocating thread while
+// another thread also frees - can move the tail backwards. When the ring
+// is full, allocate() goes to the upstream resource (null_memory_resource()
+// by default, which throws std::bad_alloc); Allocate() returns nullptr.
+
+class RingArena : public std::pmr::memory_resource {
+public:
+    static constexpr size_t kGranule = 16;           // block granularity and default alignment
+    static constexpr size_t kBufferAlign = 64;
+    
+    explicit RingArena(size_t capacity,
+                       std::pmr::memory_resource* _Nonnull upstream = std::pmr::null_memory_resource())
+        : mUpstream(upstream) {
+        mCapacity = std::max(RoundUp(capacity, kGranule), kGranule * 2);
+        mBuffer = static_cast<uint8_t*>(::operator new(mCapacity, std::align_val_t(kBufferAlign)));
+    }
+    
+    ~RingArena() override {
+        ::operator delete(mBuffer, std::align_val_t(kBufferAlign));
+    }
+    
+    // Returns nullptr when the arena is full instead of using upstream
+    inline void* _Nullable Allocate(size_t bytes, size_t alignment = kGranule) {
+        if (alignment < kGranule) alignment = kGranule;
+        if ((alignment & (alignment - 1)) != 0 || alignment > mCapacity || bytes > mCapacity) return nullptr;
+        
+        uint64_t head = mHead.load(std::memory_order_relaxed);
+        uint64_t tail = mTail.load(std::memory_order_acquire);
+        uint64_t free = mCapacity - (head - tail);
+        
+        size_t pos = (size_t)(head % mCapacity);
+        size_t userOffset = UserOffset(pos, alignment);
+        size_t span = RoundUp(userOffset + std::max<size_t>(bytes, 1), kGranule);
+        
+        // Wrap skip: the tail end of the buffer becomes a pre-freed block
+        size_t skip = 0;
+        if (pos + span > mCapacity) {
+            skip = mCapacity - pos;
+            userOffset = UserOffset(0, alignment);
+            span = RoundUp(userOffset + std::max<size_t>(bytes, 1), kGranule);
+        }
+        if (span > mCapacity || skip + span > free) {
+            RING_LOG("RingArena: %zu bytes don't fit (%llu free)", bytes, (unsigned long long)free);
+            return nullptr;
+        }
+        
+        if (skip) {
+            new (mBuffer + pos) BlockHeader{(uint64_t)skip, {1}};
+            pos = 0;
+        }
+        new (mBuffer + pos) BlockHeader{(uint64_t)span, {0}};
+        
+        uint8_t* user = mBuffer + pos + userOffset;
+        uint64_t back = userOffset;
+        std::memcpy(user - sizeof(back), &back, sizeof(back));
+        
+        mHead.store(head + skip + span, std::memory_order_release);
+        return user;
+    }
+    
+    // Releases a block from Allocate(); the tail advances over every freed
+    // block that is now at the front
+    inline void Free(void* _Nullable ptr) {
+        if (!ptr) return;
+        
+        uint8_t* user = static_cast<uint8_t*>(ptr);
+        uint64_t back;
+        std::memcpy(&back, user - sizeof(back), sizeof(back));
+        reinterpret_cast<BlockHeader*>(user - back)->freed.store(1, std::memory_order_relaxed);
+        
+        uint64_t tail = mTail.load(std::memory_order_relaxed);
+        uint64_t head = mHead.load(std::memory_order_acquire);
+        uint64_t start = tail;
+        while (tail != head) {
+            BlockHeader* block = reinterpret_cast<BlockHeader*>(mBuffer + tail % mCapacity);
+            if (!block->freed.load(std::memory_order_relaxed)) break;
+            tail += block->span;
+        }
+        if (tail != start) {
+            mTail.store(tail, std::memory_order_release);
+        }
+    }
+    
+    inline bool Owns(const void* _Nullable ptr) const {
+        return ptr >= mBuffer && ptr < mBuffer + mCapacity;
+    }
+    
+    inline size_t Capacity() const {
+        return mCapacity;
+    }
+    
+    // Bytes held by live blocks, freed blocks behind the tail and skip blocks
+    inline size_t Used() const {
+        return (size_t)(mHead.load(std::memory_order_acquire) - mTail.load(std::memory_order_acquire));
+    }
+    
+    inline uint64_t UpstreamAllocations() const {
+        return mUpstreamCount.load(std::memory_order_relaxed);
+    }
+    
+    RingArena(const RingArena&) = delete;
+    RingArena& operator=(const RingArena&) = delete;
+    
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        if (void* ptr = Allocate(bytes, alignment)) return ptr;
+        
+        mUpstreamCount.store(mUpstreamCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return mUpstream->allocate(bytes, alignment);
+    }
+    
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+        if (Owns(ptr)) {
+            Free(ptr);
+        } else {
+            mUpstream->deallocate(ptr, bytes, alignment);
+        }
+    }
+    
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+    
+private:
+    struct BlockHeader {
+        uint64_t span;                      // bytes up to the next block; arenas may exceed 4 GiB
+        std::atomic<uint32_t> freed;
+    };
+    
+    static constexpr size_t RoundUp(size_t value, size_t alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+    
+    // Distance from a block start to its aligned user pointer, leaving room
+    // for the header and the back-offset word
+    inline size_t UserOffset(size_t pos, size_t alignment) const {
+        uintptr_t start = reinterpret_cast<uintptr_t>(mBuffer + pos);
+        return RoundUp(start + sizeof(BlockHeader) + sizeof(uint64_t), alignment) - start;
+    }
+    
+    uint8_t* _Nonnull mBuffer;
+    size_t mCapacity{0};
+    std::pmr::memory_resource* _Nonnull mUpstream;
+    alignas(64) std::atomic<uint64_t> mHead{0};
+    alignas(64) std::atomic<uint64_t> mTail{0};
+    std::atomic<uint64_t> mUpstreamCount{0};
+};
@@ -6,10 +6,67 @@
  *   Updated:        Aug 3, 2025
  */
 
+#pragma once
+
 #include <algorithm>
 #include <cstring>
+#include <cstdint>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+#include <cmath>
 #include <atomic>
 #include <chrono>
+#include <charconv>
+#include <memory>
+#include <stdexcept>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#endif
+
+// Nullability qualifiers are a Clang extension; compile them away elsewhere
+#if !defined(__clang__)
+#ifndef _Nullable
+#define _Nullable
+#endif
+#ifndef _Nonnull
+#define _Nonnull
+#endif
+#endif
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define RING_BIG_ENDIAN_HOST 1
+#else
+#define RING_BIG_ENDIAN_HOST 0
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define RING_PRINTF_FORMAT(fmtIndex, argIndex) __attribute__((format(printf, fmtIndex, argIndex)))
+#else
+#define RING_PRINTF_FORMAT(fmtIndex, argIndex)
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define RING_PREFETCH(addr) __builtin_prefetch((addr), 0, 3)
+#else
+#define RING_PREFETCH(addr) ((void)(addr))
+#endif
+
+// M_PI is POSIX, not standard C++; the DSP headers share this instead
+static constexpr double kRingPi = 3.14159265358979323846;
 
 // #define DEBUG_RING
 
@@ -22,6 +79,130 @@
 } while (0)
 #endif
 
+// ===== RING CLOCK =====
+//
+// Cheap monotonic tick source used to stamp records. Reads the TSC on x86
+// (invariant TSC assumed) and the virtual counter on AArch64, so stamping
+// never enters the kernel. Other targets fall back to steady_clock.
+// The tick rate is calibrated once, lazily; call NanosPerTick() at startup
+// to keep the ~10 ms calibration off the real-time path.
+
+struct RingClock {
+    static inline uint64_t Now() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+        return __rdtsc();
+#elif defined(__aarch64__)
+        uint64_t ticks;
+        asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+        return ticks;
+#else
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+    
+    static inline double NanosPerTick() {
+        static const double nanosPerTick = Calibrate();
+        return nanosPerTick;
+    }
+    
+    static inline uint64_t ToNanos(uint64_t ticks) {
+        return (uint64_t)((double)ticks * NanosPerTick());
+    }
+    
+    static inline uint64_t FromNanos(uint64_t nanos) {
+        return (uint64_t)((double)nanos / NanosPerTick());
+    }
+    
+private:
+    static double Calibrate() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+        using clock = std::chrono::steady_clock;
+        auto t0 = clock::now();
+        uint64_t c0 = __rdtsc();
+        while (clock::now() - t0 < std::chrono::milliseconds(10)) {}
+        auto t1 = clock::now();
+        uint64_t c1 = __rdtsc();
+        double nanos = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+        return (c1 > c0) ? nanos / (double)(c1 - c0) : 1.0;
+#elif defined(__aarch64__)
+        uint64_t freq;
+        asm volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+        return freq ? 1e9 / (double)freq : 1.0;
+#else
+        return 1.0;
+#endif
+    }
+};
+
+// ===== LATENCY HISTOGRAM =====
+//
+// Log2-bucketed nanosecond histogram. Bucket 0 counts zero latencies and
+// bucket i counts [2^(i-1), 2^i) ns. Record() is meant to be called from a
+// single thread (the consumer); any thread may read the counters.
+
+class LatencyHistogram {
+public:
+    static constexpr int kBuckets = 64;
+    
+    inline void Record(uint64_t nanos) {
+        int bucket = nanos ? std::min(64 - __builtin_clzll(nanos), kBuckets - 1) : 0;
+        Bump(mBuckets[bucket], 1);
+        Bump(mCount, 1);
+        Bump(mSum, nanos);
+        if (nanos < mMin.load(std::memory_order_relaxed)) mMin.store(nanos, std::memory_order_relaxed);
+        if (nanos > mMax.load(std::memory_order_relaxed)) mMax.store(nanos, std::memory_order_relaxed);
+    }
+    
+    inline uint64_t Count() const { return mCount.load(std::memory_order_relaxed); }
+    inline uint64_t Min() const { return Count() ? mMin.load(std::memory_order_relaxed) : 0; }
+    inline uint64_t Max() const { return mMax.load(std::memory_order_relaxed); }
+    
+    inline uint64_t Mean() const {
+        uint64_t count = Count();
+        return count ? mSum.load(std::memory_order_relaxed) / count : 0;
+    }
+    
+    inline uint64_t Bucket(int index) const {
+        return (index >= 0 && index < kBuckets) ? mBuckets[index].load(std::memory_order_relaxed) : 0;
+    }
+    
+    // Upper bound (ns) of the bucket containing the p-th percentile, p in [0, 100]
+    inline uint64_t Percentile(double p) const {
+        uint64_t count = Count();
+        if (count == 0) return 0;
+        uint64_t target = (uint64_t)((double)count * std::clamp(p, 0.0, 100.0) / 100.0);
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; i++) {
+            seen += Bucket(i);
+            if (seen > target || seen == count) {
+                return (i == 0) ? 0 : std::min((uint64_t(1) << i) - 1, Max());
+            }
+        }
+        return Max();
+    }
+    
+    inline void Reset() {
+        for (auto& bucket : mBuckets) bucket.store(0, std::memory_order_relaxed);
+        mCount.store(0, std::memory_order_relaxed);
+        mSum.store(0, std::memory_order_relaxed);
+        mMin.store(UINT64_MAX, std::memory_order_relaxed);
+        mMax.store(0, std::memory_order_relaxed);
+    }
+    
+private:
+    // Single writer: a plain load/store pair avoids a locked RMW on the hot path
+    static inline void Bump(std::atomic<uint64_t>& counter, uint64_t delta) {
+        counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+    
+    std::atomic<uint64_t> mBuckets[kBuckets]{};
+    std::atomic<uint64_t> mCount{0};
+    std::atomic<uint64_t> mSum{0};
+    std::atomic<uint64_t> mMin{UINT64_MAX};
+    std::atomic<uint64_t> mMax{0};
+};
+
 class RingBuffer {
 private:
     std::atomic<int> mReadPos{0};
@@ -29,7 +210,38 @@ private:
     int mSaveFreeSpace{-1};
     int mSaveReadPos{-1};
     int mBufSize{0};
+    int mHistory{0};
     std::unique_ptr<uint8_t[]> mBuffer;
+    LatencyHistogram mLatency;
+    std::atomic<uint64_t> mExpiredCount{0};
+    
+    // Monotonic absolute stream offsets (total bytes ever written / consumed)
+    std::atomic<uint64_t> mWriteCount{0};
+    std::atomic<uint64_t> mReadCount{0};
+    uint64_t mSaveReadCount{0};
+    
+    // History retention: highest offset the producer may be writing, and the
+    // first offset that maps onto the current buffer layout
+    std::atomic<uint64_t> mWriteClaim{0};
+    uint64_t mHistoryFloor{0};
+    bool mTrackClaims{false};       // set by SetHistory(); writes skip claims until then
+    
+    // Sparse time index: stamp -> absolute offset of a record header
+    struct TimeIndexEntry {
+        std::atomic<uint64_t> stamp{0};
+        std::atomic<uint64_t> offset{0};
+    };
+    std::unique_ptr<TimeIndexEntry[]> mIndex;
+    int mIndexCapacity{0};
+    int mIndexStride{0};
+    std::atomic<uint64_t> mIndexCount{0};
+    uint64_t mIndexLastOffset{0};
+    
+    // In-place record reservation (producer side)
+    bool mResvActive{false};
+    int mResvPad{0};
+    int mResvBytes{0};
+    uint8_t mResvChannel{0};
 public:
     explicit RingBuffer(int size = 1024) {
         if (Init(size) < 0) {
@@ -56,6 +268,9 @@ public:
     inline void Empty() {
         mReadPos.store(0, std::memory_order_relaxed);
         mWritePos.store(0, std::memory_order_relaxed);
+        mReadCount.store(mWriteCount.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        mWriteClaim.store(mWriteCount.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        mHistoryFloor = mWriteCount.load(std::memory_order_relaxed);
         mSaveReadPos = -1;
         
         std::atomic_thread_fence(std::memory_order_release);
@@ -64,7 +279,7 @@ public:
     // ===== SPACE CALCULATIONS =====
     
     inline int FreeSpace(bool inAfterMarker = true) const {
-        return BufSize() - UsedSpace(inAfterMarker);
+        return std::max(BufSize() - mHistory - UsedSpace(inAfterMarker), 0);
     }
         
     inline int UsedSpace(bool inAfterMarker = true) const {
@@ -85,12 +300,13 @@ public:
         int currentRead = mReadPos.load(std::memory_order_acquire);
         int currentWrite = mWritePos.load(std::memory_order_relaxed);
         
-        // Calculate available space (keep 1 slot empty)
-        int available = (currentRead - currentWrite - 1 + mBufSize) % mBufSize;
+        // Calculate available space (keep 1 slot empty, minus retained history)
+        int available = WritableSpace(currentRead, currentWrite);
         if ((bytes = std::min(bytes, available)) == 0)
             return 0;
         
         if (data) {
+            ClaimWrite(bytes);
             int endWrite = (currentWrite + bytes) % mBufSize;
             
             if (endWrite > currentWrite) {
@@ -101,6 +317,7 @@ public:
                 std::memcpy(&mBuffer[0], static_cast<const uint8_t*>(data) + firstPart, bytes - firstPart);
             }
             
+            AddCount(mWriteCount, bytes);
             mWritePos.store(endWrite, std::memory_order_release);
             
             if (mSaveFreeSpace != -1) {
@@ -136,6 +353,7 @@ public:
                 }
             }
             
+            AddCount(mReadCount, bytes);
             mReadPos.store(endRead, std::memory_order_release);
             
             if (mSaveFreeSpace != -1) {
@@ -177,12 +395,629 @@ public:
         return bytes;
     }
     
+    // ===== BIG-ENDIAN TYPED READ/WRITE =====
+    //
+    // Typed variants for network formats: elements are stored big-endian in
+    // the ring and converted to/from host order during the copy itself.
+    // Counts are in elements, not bytes; only whole elements are transferred.
+    // An element may straddle the wrap point when BufSize() is not a multiple
+    // of sizeof(T).
+    
+    template <typename T>
+    inline int WriteDataBE(const T* _Nullable data, int count) {
+        static_assert(sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8,
+                      "WriteDataBE supports 16/32/64-bit elements");
+        if (count <= 0) return 0;
+        
+        int currentRead = mReadPos.load(std::memory_order_acquire);
+        int currentWrite = mWritePos.load(std::memory_order_relaxed);
+        
+        int available = WritableSpace(currentRead, currentWrite);
+        if ((count = std::min(count, available / (int)sizeof(T))) == 0)
+            return 0;
+        
+        if (data) {
+            int bytes = count * (int)sizeof(T);
+            ClaimWrite(bytes);
+            SwapIntoRing<sizeof(T)>(currentWrite, reinterpret_cast<const uint8_t*>(data), bytes);
+            CommitWrite(currentWrite, bytes);
+        }
+        return count;
+    }
+    
+    template <typename T>
+    inline int ReadDataBE(T* _Nullable data, int count) {
+        static_assert(sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8,
+                      "ReadDataBE supports 16/32/64-bit elements");
+        if (count <= 0) return 0;
+        
+        int currentWrite = mWritePos.load(std::memory_order_acquire);
+        int currentRead = mReadPos.load(std::memory_order_relaxed);
+        
+        int available = (currentWrite - currentRead + mBufSize) % mBufSize;
+        if ((count = std::min(count, available / (int)sizeof(T))) == 0)
+            return 0;
+        
+        int bytes = count * (int)sizeof(T);
+        if (data) {
+            SwapFromRing<sizeof(T)>(reinterpret_cast<uint8_t*>(data), currentRead, bytes);
+        }
+        
+        CommitRead(currentRead, bytes);
+        return count;
+    }
+    
+    template <typename T>
+    inline int PeekDataBE(T* dst, int count) const {
+        static_assert(sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8,
+                      "PeekDataBE supports 16/32/64-bit elements");
+        if (!dst || count <= 0) return -1;
+        
+        int currentWrite = mWritePos.load(std::memory_order_acquire);
+        int currentRead = mReadPos.load(std::memory_order_acquire);
+        
+        int available = (currentWrite - currentRead + mBufSize) % mBufSize;
+        int bytes = count * (int)sizeof(T);
+        if (available < bytes) {
+            return -1; // Not enough data
+        }
+        
+        SwapFromRing<sizeof(T)>(reinterpret_cast<uint8_t*>(dst), currentRead, bytes);
+        return count;
+    }
+    
+    // ===== FRAMED RECORDS =====
+    //
+    // Optional message framing on top of the byte stream. Each record is a
+    // RecordHeader followed by the payload, and is published in one step, so
+    // the consumer never sees a partial record. The header is stamped with
+    // RingClock::Now() at commit; ReadRecord() feeds the enqueue-to-dequeue
+    // latency into Latency(). Don't mix record and raw byte access on the
+    // same stream.
+    //
+    // A record may carry an expiry time (kRecordExpires); it is stored in an
+    // 8-byte extension right after the header. DropExpired() discards stale
+    // records at the read head in one step and counts them in ExpiredCount().
+    
+    struct RecordHeader {
+        uint32_t size;      // payload bytes following the header
+        uint16_t flags;
+        uint8_t  channel;   // logical channel for RingDemux
+        uint8_t  reserved;
+        uint64_t stamp;     // RingClock ticks at commit
+    };
+    static constexpr int kRecordHeaderBytes = (int)sizeof(RecordHeader);
+    
+    // Record flags
+    static constexpr uint16_t kRecordPad = 0x0001;     // filler up to the wrap point, skipped by readers
+    static constexpr uint16_t kRecordExpires = 0x0002; // 8-byte expiry (RingClock ticks) follows the header
+    
+    static constexpr int HeaderBytes(const RecordHeader& header) {
+        return kRecordHeaderBytes + ((header.flags & kRecordExpires) ? (int)sizeof(uint64_t) : 0);
+    }
+    
+    // Writes one record; returns payload bytes (0 for an empty record), or
+    // -1 if it doesn't fit whole or the arguments are bad (negative size,
+    // null data with a non-zero size). A non-zero expiry (RingClock ticks)
+    // marks the record as droppable by DropExpired() once that time has passed.
+    inline int WriteRecord(const void* _Nullable data, int bytes, uint8_t channel = 0, uint64_t expiry = 0) {
+        if (bytes < 0 || (!data && bytes > 0)) return -1;
+        
+        int currentRead = mReadPos.load(std::memory_order_acquire);
+        int currentWrite = mWritePos.load(std::memory_order_relaxed);
+        
+        RecordHeader header{(uint32_t)bytes, expiry ? kRecordExpires : (uint16_t)0, channel, 0, 0};
+        int headerBytes = HeaderBytes(header);
+        
+        int available = WritableSpace(currentRead, currentWrite);
+        int total = headerBytes + bytes;
+        if (total > available) {
+            RING_LOG("WriteRecord: record %d > available %d", total, available);
+            return -1;
+        }
+        
+        ClaimWrite(total);
+        if (bytes > 0) {
+            CopyToRing((currentWrite + headerBytes) % mBufSize, data, bytes);
+        }
+        if (expiry) {
+            CopyToRing((currentWrite + kRecordHeaderBytes) % mBufSize, &expiry, sizeof(expiry));
+        }
+        
+        header.stamp = RingClock::Now();
+        CopyToRing(currentWrite, &header, kRecordHeaderBytes);
+        
+        uint64_t offset = mWriteCount.load(std::memory_order_relaxed);
+        CommitWrite(currentWrite, total);
+        IndexRecord(header.stamp, offset);
+        return bytes;
+    }
+    
+    // Writes a record that expires ttlNanos from now
+    inline int WriteRecordTTL(const void* _Nullable data, int bytes, uint64_t ttlNanos, uint8_t channel = 0) {
+        return WriteRecord(data, bytes, channel, RingClock::Now() + std::max<uint64_t>(RingClock::FromNanos(ttlNanos), 1));
+    }
+    
+    // Payload size of the record at the read head, or -1 if none is available
+    inline int NextRecordSize() const {
+        RecordHeader header;
+        if (!PeekRecordHeader(header)) return -1;
+        return (int)header.size;
+    }
+    
+    // Copies the header of the record at the read head; false if none
+    inline bool PeekRecordHeader(RecordHeader& header) const {
+        int skip;
+        return FindRecord(header, skip);
+    }
+    
+    // Moves the record at the read head into dst with a single ring-to-ring
+    // copy, keeping its header (channel and original stamp). Returns payload
+    // bytes, 0 if no record is available, or -1 if dst has no room (the
+    // record stays queued). This ring is the consumer side, dst the producer.
+    inline int ForwardRecord(RingBuffer& dst) {
+        RecordHeader header;
+        int skip;
+        if (!FindRecord(header, skip)) return 0;
+        
+        int bytes = (int)header.size;
+        int headerBytes = HeaderBytes(header);
+        int total = headerBytes + bytes;
+        
+        int dstRead = dst.mReadPos.load(std::memory_order_acquire);
+        int dstWrite = dst.mWritePos.load(std::memory_order_relaxed);
+        if (total > dst.WritableSpace(dstRead, dstWrite)) {
+            return -1;
+        }
+        dst.ClaimWrite(total);
+        
+        int currentRead = mReadPos.load(std::memory_order_relaxed);
+        int srcPos = (currentRead + skip + headerBytes) % mBufSize;
+        int dstPos = (dstWrite + headerBytes) % dst.mBufSize;
+        int firstPart = std::min(bytes, mBufSize - srcPos);
+        if (firstPart > 0) {
+            dst.CopyToRing(dstPos, &mBuffer[srcPos], firstPart);
+        }
+        if (bytes > firstPart) {
+            dst.CopyToRing((dstPos + firstPart) % dst.mBufSize, &mBuffer[0], bytes - firstPart);
+        }
+        uint8_t frame[kRecordHeaderBytes + sizeof(uint64_t)];
+        CopyFromRing(frame, (currentRead + skip) % mBufSize, headerBytes);
+        dst.CopyToRing(dstWrite, frame, headerBytes);
+        
+        uint64_t offset = dst.mWriteCount.load(std::memory_order_relaxed);
+        dst.CommitWrite(dstWrite, total);
+        dst.IndexRecord(header.stamp, offset);
+        
+        CommitRead(currentRead, skip + total);
+        return bytes;
+    }
+    
+    // Reads one record into data; returns payload bytes, 0 if no record is
+    // available, or -1 if maxBytes is too small (the record stays queued).
+    // A null data pointer drops the record.
+    inline int ReadRecord(void* _Nullable data, int maxBytes) {
+        RecordHeader header;
+        int skip;
+        if (!FindRecord(header, skip)) return 0;
+        
+        int bytes = (int)header.size;
+        if (data && bytes > maxBytes) {
+            RING_LOG("ReadRecord: record %d > buffer %d", bytes, maxBytes);
+            return -1;
+        }
+        
+        int currentRead = mReadPos.load(std::memory_order_relaxed);
+        if (data && bytes > 0) {
+            CopyFromRing(data, (currentRead + skip + HeaderBytes(header)) % mBufSize, bytes);
+        }
+        
+        if (header.stamp) {
+            uint64_t now = RingClock::Now();
+            mLatency.Record(now > header.stamp ? RingClock::ToNanos(now - header.stamp) : 0);
+        }
+        
+        CommitRead(currentRead, skip + HeaderBytes(header) + bytes);
+        return bytes;
+    }
+    
+    inline int SkipRecord() {
+        return ReadRecord(nullptr, 0);
+    }
+    
+    // Zero-copy view of the payload at the read head, valid until the record
+    // is released with SkipRecord(). Returns null if no record is available
+    // or its payload wraps (records from BeginRecord() never wrap).
+    inline const uint8_t* _Nullable PeekRecordView(RecordHeader& header) const {
+        int skip;
+        if (!FindRecord(header, skip)) return nullptr;
+        
+        int currentRead = mReadPos.load(std::memory_order_relaxed);
+        int payloadPos = (currentRead + skip + HeaderBytes(header)) % mBufSize;
+        if (payloadPos + (int)header.size > mBufSize) return nullptr;
+        return &mBuffer[payloadPos];
+    }
+    
+    // Drops every expired record at the read head with a single read-head
+    // advance, stopping at the first live record. Returns records dropped.
+    inline int DropExpired(uint64_t now = RingClock::Now()) {
+        int currentWrite = mWritePos.load(std::memory_order_acquire);
+        int currentRead = mReadPos.load(std::memory_order_relaxed);
+        
+        int available = (currentWrite - currentRead + mBufSize) % mBufSize;
+        int skip = 0;
+        int dropped = 0;
+        while (available - skip >= kRecordHeaderBytes) {
+            RecordHeader header;
+            int pos = (currentRead + skip) % mBufSize;
+            CopyFromRing(&header, pos, kRecordHeaderBytes);
+            
+            int total = HeaderBytes(header) + (int)header.size;
+            if (total > available - skip) break;
+            
+            if (!(header.flags & kRecordPad)) {
+                if (!(header.flags & kRecordExpires)) break;
+                uint64_t expiry;
+                CopyFromRing(&expiry, (pos + kRecordHeaderBytes) % mBufSize, sizeof(expiry));
+                if (expiry > now) break;
+                dropped++;
+            }
+            skip += total;
+        }
+        
+        if (skip > 0) {
+            CommitRead(currentRead, skip);
+        }
+        if (dropped > 0) {
+            AddCount(mExpiredCount, dropped);
+            RING_LOG("DropExpired: dropped %d records (%d bytes)", dropped, skip);
+        }
+        return dropped;
+    }
+    
+    inline uint64_t ExpiredCount() const {
+        return mExpiredCount.load(std::memory_order_relaxed);
+    }
+    
+    // ===== IN-PLACE RECORD RESERVATION =====
+    //
+    // BeginRecord() reserves a contiguous payload region directly in ring
+    // memory so a record can be built in place. If the region would straddle
+    // the wrap point a padding record fills the tail and the payload starts
+    // at the beginning of the buffer. GrowRecord() enlarges the reservation,
+    // relocating what was written so far if the current run is too short.
+    // Nothing is visible to the consumer until CommitRecord(). Producer only;
+    // one reservation at a time.
+    
+    inline uint8_t* _Nullable BeginRecord(int bytes, uint8_t channel = 0) {
+        if (bytes < 0 || mResvActive) return nullptr;
+        
+        int currentWrite = mWritePos.load(std::memory_order_relaxed);
+        int pad;
+        if (!PlaceRecord(currentWrite, bytes, pad)) {
+            RING_LOG("BeginRecord: no room for %d bytes", bytes);
+            return nullptr;
+        }
+        
+        mResvActive = true;
+        mResvPad = pad;
+        mResvBytes = bytes;
+        mResvChannel = channel;
+        return &mBuffer[ResvPayloadPos(currentWrite)];
+    }
+    
+    // Returns the (possibly moved) payload pointer, or null if there is no
+    // room; the existing reservation stays valid either way
+    inline uint8_t* _Nullable GrowRecord(int bytes) {
+        if (!mResvActive) return nullptr;
+        
+        int currentWrite = mWritePos.load(std::memory_order_relaxed);
+        int oldPos = ResvPayloadPos(currentWrite);
+        if (bytes <= mResvBytes) return &mBuffer[oldPos];
+        
+        int pad;
+        if (!PlaceRecord(currentWrite, bytes, pad)) {
+            RING_LOG("GrowRecord: no room for %d bytes", bytes);
+            return nullptr;
+        }
+        
+        int oldBytes = mResvBytes;
+        mResvPad = pad;
+        mResvBytes = bytes;
+        int newPos = ResvPayloadPos(currentWrite);
+        if (newPos != oldPos && oldBytes > 0) {
+            std::memmove(&mBuffer[newPos], &mBuffer[oldPos], oldBytes);
+        }
+        return &mBuffer[newPos];
+    }
+    
+    // Publishes the first `bytes` of the reservation as one record
+    inline int CommitRecord(int bytes) {
+        if (!mResvActive || bytes < 0 || bytes > mResvBytes) return -1;
+        
+        int currentWrite = mWritePos.load(std::memory_order_relaxed);
+        if (mResvPad) {
+            RecordHeader pad{(uint32_t)(mResvPad - kRecordHeaderBytes), kRecordPad, 0, 0, 0};
+            CopyToRing(currentWrite, &pad, kRecordHeaderBytes);
+        }
+        
+        int headerPos = (currentWrite + mResvPad) % mBufSize;
+        RecordHeader header{(uint32_t)bytes, 0, mResvChannel, 0, RingClock::Now()};
+        CopyToRing(headerPos, &header, kRecordHeaderBytes);
+        
+        uint64_t offset = mWriteCount.load(std::memory_order_relaxed) + mResvPad;
+        CommitWrite(currentWrite, mResvPad + kRecordHeaderBytes + bytes);
+        IndexRecord(header.stamp, offset);
+        
+        mResvActive = false;
+        return bytes;
+    }
+    
+    inline void CancelRecord() {
+        mResvActive = false;
+    }
+    
+    inline const LatencyHistogram& Latency() const {
+        return mLatency;
+    }
+    
+    inline void ResetLatency() {
+        mLatency.Reset();
+    }
+    
+    // ===== FORMATTED WRITES =====
+    //
+    // printf-style formatting straight into the writable region, spilling
+    // over the wrap point and publishing once at the end. Numbers are
+    // converted with std::to_chars into a small stack scratch; there is no
+    // heap use and no snprintf temp buffer. Supports the - + space 0 #
+    // flags, width and precision (including '*'), the hh h l ll j z t
+    // length modifiers and the d i u o x X c s p f F e E g G a A %
+    // conversions; wide %lc/%ls, long double (%Lf etc.) and %n are not
+    // supported. A single numeric field is limited to the stack scratch
+    // (e.g. "%.50f" of 1e308 fails).
+    // Returns bytes written, or -1 with nothing published if the output
+    // doesn't fit in FreeSpace() or the format can't be honoured.
+    
+    RING_PRINTF_FORMAT(2, 3)
+    inline int FormatInto(const char* _Nonnull fmt, ...) {
+        va_list args;
+        va_start(args, fmt);
+        int bytes = FormatIntoV(fmt, args);
+        va_end(args);
+        return bytes;
+    }
+    
+    inline int FormatIntoV(const char* _Nonnull fmt, va_list args) {
+        int currentRead = mReadPos.load(std::memory_order_acquire);
+        int currentWrite = mWritePos.load(std::memory_order_relaxed);
+        
+        FormatCursor out{this, currentWrite, WritableSpace(currentRead, currentWrite), 0, false, false};
+        ClaimWrite(out.room);
+        
+        // A local copy can be passed by reference even where va_list is an array type
+        va_list ap;
+        va_copy(ap, args);
+        for (const char* p = fmt; *p && !out.overflow && !out.failed; ) {
+            const char* literal = p;
+            while (*p && *p != '%') p++;
+            out.Put(literal, (int)(p - literal));
+            if (!*p) break;
+            
+            FormatSpec spec;
+            p = ParseSpec(p + 1, spec, ap);
+            FormatArg(out, spec, ap);
+        }
+        va_end(ap);
+        
+        if (out.failed) return -1;
+        if (out.overflow) {
+            RING_LOG("FormatInto: output exceeds %d free bytes", out.room);
+            return -1;
+        }
+        if (out.written > 0) {
+            CommitWrite(currentWrite, out.written);
+        }
+        return out.written;
+    }
+    
+    // ===== ABSOLUTE OFFSETS & TIME INDEX =====
+    //
+    // WriteCount()/ReadCount() are monotonic absolute stream offsets. When the
+    // time index is enabled, WriteRecord() drops an entry (stamp, offset) at
+    // the first record after every strideBytes of stream (every record when
+    // strideBytes is 0). Seeks binary-search the entries that still point
+    // into the valid region and then walk record headers forward, so they are
+    // exact without a linear scan of the ring. Record mode only.
+    
+    inline uint64_t WriteCount() const {
+        return mWriteCount.load(std::memory_order_acquire);
+    }
+    
+    inline uint64_t ReadCount() const {
+        return mReadCount.load(std::memory_order_acquire);
+    }
+    
+    // Call before streaming starts. Capacity defaults to (and is at least)
+    // enough entries to cover the whole ring at the given stride.
+    inline int EnableTimeIndex(int strideBytes = 0, int capacity = 0) {
+        strideBytes = std::max(strideBytes, 0);
+        int minCapacity = mBufSize / std::max(strideBytes, kRecordHeaderBytes) + 2;
+        capacity = std::max(capacity, minCapacity);
+        try {
+            mIndex = std::unique_ptr<TimeIndexEntry[]>(new TimeIndexEntry[capacity]);
+        } catch (const std::bad_alloc&) {
+            RING_LOG("EnableTimeIndex: allocation failed for %d entries", capacity);
+            return -1;
+        }
+        mIndexCapacity = capacity;
+        mIndexStride = strideBytes;
+        mIndexCount.store(0, std::memory_order_release);
+        mIndexLastOffset = 0;
+        return 0;
+    }
+    
+    // Absolute offset of the first readable or retained record stamped at
+    // or after `stamp`, or -1 if no such record has been published yet.
+    // Without index entries in the retained window the search starts at
+    // the read head.
+    inline int64_t OffsetForTime(uint64_t stamp) const {
+        int currentWrite = mWritePos.load(std::memory_order_acquire);
+        int currentRead = mReadPos.load(std::memory_order_relaxed);
+        uint64_t readCount = mReadCount.load(std::memory_order_relaxed);
+        uint64_t writeCount = readCount + (uint64_t)((currentWrite - currentRead + mBufSize) % mBufSize);
+        
+        uint64_t lowest = RetainedOffset();
+        uint64_t offset = readCount;
+        if (mIndex) {
+            uint64_t count = mIndexCount.load(std::memory_order_acquire);
+            uint64_t lo = (count > (uint64_t)mIndexCapacity) ? count - mIndexCapacity : 0;
+            uint64_t hi = count;
+            
+            // First entry still inside the valid region
+            while (lo < hi) {
+                uint64_t mid = lo + (hi - lo) / 2;
+                if (IndexEntry(mid).offset.load(std::memory_order_relaxed) < lowest) lo = mid + 1;
+                else hi = mid;
+            }
+            // Last valid entry stamped at or before `stamp`
+            hi = count;
+            uint64_t first = lo;
+            while (lo < hi) {
+                uint64_t mid = lo + (hi - lo) / 2;
+                if (IndexEntry(mid).stamp.load(std::memory_order_relaxed) <= stamp) lo = mid + 1;
+                else hi = mid;
+            }
+            if (lo > first) {
+                uint64_t entryOffset = IndexEntry(lo - 1).offset.load(std::memory_order_relaxed);
+                if (entryOffset >= lowest && entryOffset < writeCount) offset = entryOffset;
+            }
+        }
+        
+        while (offset + kRecordHeaderBytes <= writeCount) {
+            RecordHeader header;
+            CopyFromRing(&header, PosForOffset(offset, currentRead, readCount), kRecordHeaderBytes);
+            if (!(header.flags & kRecordPad) && header.stamp >= stamp) return (int64_t)offset;
+            offset += HeaderBytes(header) + header.size;
+        }
+        return -1;
+    }
+    
+    // Moves the read head to an absolute offset in [RetainedOffset(), WriteCount()]
+    inline int SeekOffset(uint64_t offset) {
+        uint64_t readCount = mReadCount.load(std::memory_order_relaxed);
+        if (offset < RetainedOffset() || (offset > readCount && offset - readCount > (uint64_t)INT32_MAX)) {
+            RING_LOG("SeekOffset: offset %llu outside readable region", (unsigned long long)offset);
+            return -1;
+        }
+        if (offset >= readCount) {
+            int bytes = (int)(offset - readCount);
+            return (SkipData(bytes) == bytes) ? 0 : -1;
+        }
+        
+        // Backward into retained history: those bytes can't have been reused
+        int bytes = (int)(readCount - offset);
+        int currentRead = mReadPos.load(std::memory_order_relaxed);
+        int newRead = (currentRead - bytes + mBufSize) % mBufSize;
+        AddCount(mReadCount, -bytes);
+        mReadPos.store(newRead, std::memory_order_release);
+        
+        if (mSaveFreeSpace != -1) {
+            mSaveFreeSpace += bytes;
+        }
+        RING_LOG("SeekOffset: back %d bytes into history, readPos %d→%d", bytes, currentRead, newRead);
+        return 0;
+    }
+    
+    // Skips to the first record stamped at or after `stamp`
+    inline int SeekTime(uint64_t stamp) {
+        int64_t offset = OffsetForTime(stamp);
+        return (offset < 0) ? -1 : SeekOffset((uint64_t)offset);
+    }
+    
+    // ===== HISTORY RETENTION =====
+    //
+    // With a history window of N bytes the producer never overwrites the N
+    // most recently consumed bytes, so they stay readable by absolute offset
+    // (late joiners, retransmits) and SeekOffset() may move back into them.
+    // The window is carved out of the capacity: FreeSpace() shrinks by N.
+    // Older consumed bytes remain readable on a best-effort basis until the
+    // producer reuses them; ReadHistory() detects that race and fails. That
+    // detection costs every write a claim store, so it only starts once
+    // SetHistory() has been called (even with 0); before then consumed bytes
+    // are treated as gone.
+    
+    // Call while the ring is quiescent; bytes must be below BufSize()
+    inline int SetHistory(int bytes) {
+        if (bytes < 0 || bytes >= BufSize()) {
+            RING_LOG("SetHistory: %d outside [0, %d)", bytes, BufSize());
+            return -1;
+        }
+        mHistory = bytes;
+        if (!mTrackClaims) {
+            mTrackClaims = true;
+            mWriteClaim.store(mWriteCount.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        return 0;
+    }
+    
+    inline int History() const {
+        return mHistory;
+    }
+    
+    // First absolute offset guaranteed to stay intact. After seeking back
+    // the window can be shorter than History() until reads catch up.
+    inline uint64_t RetainedOffset() const {
+        uint64_t readCount = mReadCount.load(std::memory_order_relaxed);
+        return std::max(OldestOffset(), readCount > (uint64_t)mHistory ? readCount - mHistory : 0);
+    }
+    
+    // First absolute offset not yet reused by the producer (may move at any time)
+    inline uint64_t OldestOffset() const {
+        if (!mTrackClaims) {
+            return std::max(mReadCount.load(std::memory_order_relaxed), mHistoryFloor);
+        }
+        uint64_t claim = mWriteClaim.load(std::memory_order_acquire);
+        return std::max(claim > (uint64_t)mBufSize ? claim - mBufSize : 0, mHistoryFloor);
+    }
+    
+    // Copies bytes at an absolute offset, consumed or not, without moving
+    // the read head. Returns bytes, or -1 if the range is not (or no longer)
+    // intact. Consumer thread only.
+    inline int ReadHistory(uint64_t offset, void* dst, int bytes) const {
+        if (!dst || bytes <= 0) return -1;
+        
+        int currentWrite = mWritePos.load(std::memory_order_acquire);
+        int currentRead = mReadPos.load(std::memory_order_relaxed);
+        uint64_t readCount = mReadCount.load(std::memory_order_relaxed);
+        uint64_t writeCount = readCount + (uint64_t)((currentWrite - currentRead + mBufSize) % mBufSize);
+        
+        if (offset < mHistoryFloor || offset + (uint64_t)bytes > writeCount || bytes > mBufSize) {
+            RING_LOG("ReadHistory: [%llu, +%d) outside stream", (unsigned long long)offset, bytes);
+            return -1;
+        }
+        if (offset < OldestOffset()) {
+            return -1;
+        }
+        
+        CopyFromRing(dst, PosForOffset(offset, currentRead, readCount), bytes);
+        
+        // Validate after the copy: fails if the producer claimed our slots meanwhile
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (offset < OldestOffset()) {
+            RING_LOG("ReadHistory: [%llu, +%d) overwritten during copy", (unsigned long long)offset, bytes);
+            return -1;
+        }
+        return bytes;
+    }
+    
     // ===== SAVE/RESTORE FOR PEEK MODE =====
     
     inline void SaveRead() {
         if (mSaveReadPos != -1) return;  // Already saved
         
         mSaveReadPos = mReadPos.load(std::memory_order_acquire);
+        mSaveReadCount = mReadCount.load(std::memory_order_relaxed);
         mSaveFreeSpace = FreeSpace(true);  // Save current free space
         
         RING_LOG("SaveRead: saved readPos=%d, freeSpace=%d", mSaveReadPos, mSaveFreeSpace);
@@ -195,6 +1030,7 @@ public:
         }
         
         int oldPos = mReadPos.load(std::memory_order_relaxed);
+        mReadCount.store(mSaveReadCount, std::memory_order_relaxed);
         mReadPos.store(mSaveReadPos, std::memory_order_release);
         
         RING_LOG("RestoreRead: restored readPos %d→%d, freeSpace=%d",
@@ -232,6 +1068,7 @@ public:
             return 0;
         
         int endRead = (currentRead + bytes) % mBufSize;
+        AddCount(mReadCount, bytes);
         mReadPos.store(endRead, std::memory_order_release);
         
         RING_LOG("SkipData: skipped %d bytes, readPos %d->%d", bytes, currentRead, endRead);
@@ -263,6 +1100,7 @@ public:
         }
         
         int newRead = (currentRead - bytes + mBufSize) % mBufSize;
+        AddCount(mReadCount, -bytes);
         mReadPos.store(newRead, std::memory_order_release);
         
         // ✅ UPDATE SAVED FREE SPACE WHEN REWINDING
@@ -292,19 +1130,22 @@ public:
                 return -1;
             }
         } else {
-            // Backward offset - check if we have save state
-            if (mSaveReadPos == -1) {
-                RING_LOG("Offset: backward offset requires save state");
+            // Backward offset - allowed back to the save point or into retained history
+            uint64_t retained = mReadCount.load(std::memory_order_relaxed) - RetainedOffset();
+            if (mSaveReadPos == -1 && retained == 0) {
+                RING_LOG("Offset: backward offset requires save state or history");
                 return -1;
             }
             
-            int maxBackward = (currentRead - mSaveReadPos + mBufSize) % mBufSize;
+            int maxBackward = (mSaveReadPos != -1) ? (currentRead - mSaveReadPos + mBufSize) % mBufSize : 0;
+            maxBackward = std::max(maxBackward, (int)retained);
             if (-delta > maxBackward) {
                 RING_LOG("Offset: backward offset %d > max %d", -delta, maxBackward);
                 return -1;
             }
         }
         
+        AddCount(mReadCount, delta);
         mReadPos.store(newRead, std::memory_order_release);
         
        if (mSaveFreeSpace != -1) {
@@ -368,15 +1209,578 @@ public:
         // Check space calculations are consistent
         int used = UsedSpace();
         int free = FreeSpace();
+        int retained = std::min(mHistory, BufSize() - used);
         
-        if (used + free + 1 != mBufSize) { // +1 for the reserved slot
-            RING_LOG("❌ Space calculation error: used=%d + free=%d + 1 != size=%d", used, free, mBufSize);
+        if (used + free + retained + 1 != mBufSize) { // +1 for the reserved slot
+            RING_LOG("❌ Space calculation error: used=%d + free=%d + history=%d + 1 != size=%d",
+                     used, free, retained, mBufSize);
             return false;
         }
         
         return true;
     }
     
+private:
+    // ===== INTERNAL COPY/COMMIT HELPERS =====
+    
+    inline void CopyToRing(int pos, const void* src, int bytes) {
+        int firstPart = mBufSize - pos;
+        if (bytes <= firstPart) {
+            std::memcpy(&mBuffer[pos], src, bytes);
+        } else {
+            std::memcpy(&mBuffer[pos], src, firstPart);
+            std::memcpy(&mBuffer[0], static_cast<const uint8_t*>(src) + firstPart, bytes - firstPart);
+        }
+    }
+    
+    inline void CopyFromRing(void* dst, int pos, int bytes) const {
+        int firstPart = mBufSize - pos;
+        if (bytes <= firstPart) {
+            std::memcpy(dst, &mBuffer[pos], bytes);
+        } else {
+            std::memcpy(dst, &mBuffer[pos], firstPart);
+            std::memcpy(static_cast<uint8_t*>(dst) + firstPart, &mBuffer[0], bytes - firstPart);
+        }
+    }
+    
+    inline void CommitWrite(int currentWrite, int bytes) {
+        int endWrite = (currentWrite + bytes) % mBufSize;
+        AddCount(mWriteCount, bytes);
+        mWritePos.store(endWrite, std::memory_order_release);
+        
+        if (mSaveFreeSpace != -1) {
+            mSaveFreeSpace = std::max(mSaveFreeSpace - bytes, 0);
+        }
+        RING_LOG("CommitWrite: %d bytes, writePos %d→%d", bytes, currentWrite, endWrite);
+    }
+    
+    inline void CommitRead(int currentRead, int bytes) {
+        int endRead = (currentRead + bytes) % mBufSize;
+        AddCount(mReadCount, bytes);
+        mReadPos.store(endRead, std::memory_order_release);
+        
+        if (mSaveFreeSpace != -1) {
+            mSaveFreeSpace = std::max(mSaveFreeSpace - bytes, 0);
+        }
+        RING_LOG("CommitRead: %d bytes, readPos %d→%d", bytes, currentRead, endRead);
+    }
+    
+    // Counters have a single writer each, so no locked RMW is needed
+    static inline void AddCount(std::atomic<uint64_t>& counter, int64_t delta) {
+        counter.store(counter.load(std::memory_order_relaxed) + (uint64_t)delta, std::memory_order_relaxed);
+    }
+    
+    // Free bytes the producer may fill: one slot stays empty and the most
+    // recently consumed mHistory bytes are protected
+    inline int WritableSpace(int currentRead, int currentWrite) const {
+        int available = (currentRead - currentWrite - 1 + mBufSize) % mBufSize;
+        return std::max(available - mHistory, 0);
+    }
+    
+    // Announces the bytes about to be overwritten before they are touched, so
+    // ReadHistory() can detect a copy that raced with the producer
+    inline void ClaimWrite(int bytes) {
+        if (!mTrackClaims) return;
+        mWriteClaim.store(mWriteCount.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    
+    // Header of the first non-padding record at the read head, and the
+    // padding bytes in front of it
+    inline bool FindRecord(RecordHeader& header, int& skip) const {
+        int currentWrite = mWritePos.load(std::memory_order_acquire);
+        int currentRead = mReadPos.load(std::memory_order_relaxed);
+        
+        int available = (currentWrite - currentRead + mBufSize) % mBufSize;
+        skip = 0;
+        while (available - skip >= kRecordHeaderBytes) {
+            CopyFromRing(&header, (currentRead + skip) % mBufSize, kRecordHeaderBytes);
+            if (HeaderBytes(header) + (int)header.size > available - skip) return false;
+            if (!(header.flags & kRecordPad)) return true;
+            skip += HeaderBytes(header) + (int)header.size;
+        }
+        return false;
+    }
+    
+    // Chooses where a contiguous payload of `bytes` goes: padding is only
+    // needed when the tail holds more than a header but not the payload.
+    // Claims the space on success.
+    inline bool PlaceRecord(int currentWrite, int bytes, int& pad) {
+        int tail = mBufSize - currentWrite;
+        pad = (tail > kRecordHeaderBytes && tail < kRecordHeaderBytes + bytes) ? tail : 0;
+        
+        int payloadPos = (currentWrite + pad + kRecordHeaderBytes) % mBufSize;
+        int total = pad + kRecordHeaderBytes + bytes;
+        int currentRead = mReadPos.load(std::memory_order_acquire);
+        if (payloadPos + bytes > mBufSize || total > WritableSpace(currentRead, currentWrite)) {
+            return false;
+        }
+        ClaimWrite(total);
+        return true;
+    }
+    
+    inline int ResvPayloadPos(int currentWrite) const {
+        return (currentWrite + mResvPad + kRecordHeaderBytes) % mBufSize;
+    }
+    
+    // Ring position of an absolute offset, relative to the current read head
+    inline int PosForOffset(uint64_t offset, int currentRead, uint64_t readCount) const {
+        int64_t delta = (int64_t)(offset - readCount) % mBufSize;
+        return (int)((currentRead + delta + mBufSize) % mBufSize);
+    }
+    
+    inline void IndexRecord(uint64_t stamp, uint64_t offset) {
+        if (mIndex && (mIndexCount.load(std::memory_order_relaxed) == 0 ||
+                       offset - mIndexLastOffset >= (uint64_t)mIndexStride)) {
+            AddIndexEntry(stamp, offset);
+        }
+    }
+    
+    inline void AddIndexEntry(uint64_t stamp, uint64_t offset) {
+        uint64_t count = mIndexCount.load(std::memory_order_relaxed);
+        TimeIndexEntry& entry = mIndex[count % (uint64_t)mIndexCapacity];
+        entry.stamp.store(stamp, std::memory_order_relaxed);
+        entry.offset.store(offset, std::memory_order_relaxed);
+        mIndexCount.store(count + 1, std::memory_order_release);
+        mIndexLastOffset = offset;
+    }
+    
+    inline const TimeIndexEntry& IndexEntry(uint64_t index) const {
+        return mIndex[index % (uint64_t)mIndexCapacity];
+    }
+    
+    // ===== FORMATTING HELPERS =====
+    
+    struct FormatCursor {
+        RingBuffer* ring;
+        int start;
+        int room;
+        int written;
+        bool overflow;
+        bool failed;        // unsupported spec or oversized field; already logged
+        
+        inline void Put(const char* src, int bytes) {
+            if (bytes <= 0 || overflow) return;
+            if (bytes > room - written) {
+                overflow = true;
+                return;
+            }
+            ring->CopyToRing((start + written) % ring->mBufSize, src, bytes);
+            written += bytes;
+        }
+        
+        inline void Fill(char c, int count) {
+            if (count <= 0 || overflow) return;
+            if (count > room - written) {
+                overflow = true;
+                return;
+            }
+            int pos = (start + written) % ring->mBufSize;
+            int firstPart = std::min(count, ring->mBufSize - pos);
+            std::memset(&ring->mBuffer[pos], c, firstPart);
+            std::memset(&ring->mBuffer[0], c, count - firstPart);
+            written += count;
+        }
+    };
+    
+    struct FormatSpec {
+        bool leftAlign{false};
+        bool zeroPad{false};
+        char sign{0};           // '+', ' ' or 0
+        bool alternate{false};  // '#'
+        int width{0};
+        int precision{-1};
+        char length{0};         // 'H' = hh, 'h', 'l', 'L' = ll, 'j', 'z', 't', 'D' = L
+        char conversion{0};
+    };
+    
+    static inline const char* ParseSpec(const char* p, FormatSpec& spec, va_list& args) {
+        for (;; p++) {
+            if (*p == '-') spec.leftAlign = true;
+            else if (*p == '0') spec.zeroPad = true;
+            else if (*p == '+') spec.sign = '+';
+            else if (*p == ' ') { if (!spec.sign) spec.sign = ' '; }
+            else if (*p == '#') spec.alternate = true;
+            else break;
+        }
+        
+        if (*p == '*') {
+            spec.width = va_arg(args, int);
+            if (spec.width < 0) { spec.leftAlign = true; spec.width = -spec.width; }
+            p++;
+        } else {
+            while (*p >= '0' && *p <= '9') spec.width = spec.width * 10 + (*p++ - '0');
+        }
+        
+        if (*p == '.') {
+            p++;
+            spec.precision = 0;
+            if (*p == '*') {
+                spec.precision = std::max(va_arg(args, int), -1);
+                p++;
+            } else {
+                while (*p >= '0' && *p <= '9') spec.precision = spec.precision * 10 + (*p++ - '0');
+            }
+        }
+        
+        if (*p == 'h') { spec.length = (p[1] == 'h') ? 'H' : 'h'; p += (p[1] == 'h') ? 2 : 1; }
+        else if (*p == 'l') { spec.length = (p[1] == 'l') ? 'L' : 'l'; p += (p[1] == 'l') ? 2 : 1; }
+        else if (*p == 'j' || *p == 'z' || *p == 't' || *p == 'L') { spec.length = (*p == 'L') ? 'D' : *p; p++; }
+        
+        spec.conversion = *p;
+        return *p ? p + 1 : p;
+    }
+    
+    // Emits prefix + body justified to the field width; zero padding goes
+    // between the two (after the sign / 0x)
+    static inline void PutPadded(FormatCursor& out, const FormatSpec& spec,
+                                 const char* prefix, int prefixLen, const char* body, int bodyLen, int zeros = 0) {
+        int pad = std::max(spec.width - prefixLen - zeros - bodyLen, 0);
+        if (!spec.leftAlign && !spec.zeroPad) out.Fill(' ', pad);
+        out.Put(prefix, prefixLen);
+        if (!spec.leftAlign && spec.zeroPad) out.Fill('0', pad);
+        out.Fill('0', zeros);
+        out.Put(body, bodyLen);
+        if (spec.leftAlign) out.Fill(' ', pad);
+    }
+    
+    static inline void FormatInteger(FormatCursor& out, const FormatSpec& spec,
+                                     unsigned long long magnitude, bool negative, int base, bool upper) {
+        char digits[72];
+        int len = 0;
+        if (!(magnitude == 0 && spec.precision == 0)) {
+            len = (int)(std::to_chars(digits, digits + sizeof(digits), magnitude, base).ptr - digits);
+        }
+        if (upper) {
+            for (int i = 0; i < len; i++) {
+                if (digits[i] >= 'a') digits[i] -= 'a' - 'A';
+            }
+        }
+        
+        char prefix[2];
+        int prefixLen = 0;
+        if (negative) prefix[prefixLen++] = '-';
+        else if (spec.sign && spec.conversion != 'u' && base == 10) prefix[prefixLen++] = spec.sign;
+        if (spec.alternate && base == 16 && magnitude != 0) {
+            prefix[prefixLen++] = '0';
+            prefix[prefixLen++] = upper ? 'X' : 'x';
+        }
+        
+        int zeros = std::max(spec.precision - len, 0);
+        // %#o: raise the precision just enough for a leading zero
+        if (spec.alternate && base == 8 && zeros == 0 && (len == 0 || digits[0] != '0')) zeros = 1;
+        
+        FormatSpec padSpec = spec;
+        if (spec.precision >= 0) padSpec.zeroPad = false;
+        PutPadded(out, padSpec, prefix, prefixLen, digits, len, zeros);
+    }
+    
+    // '#' for floats: always print the decimal point and, for %g, keep the
+    // trailing zeros up to the precision. Edits the mantissa in place ahead
+    // of any exponent; returns the new length or -1 if it no longer fits.
+    static inline int ForceDecimalPoint(char* digits, int len, int capacity, char lower, int precision) {
+        char expChar = (lower == 'a') ? 'p' : 'e';
+        int mantissa = 0;
+        while (mantissa < len && digits[mantissa] != expChar) mantissa++;
+        
+        int extra = 0;
+        bool hasPoint = std::memchr(digits, '.', mantissa) != nullptr;
+        if (!hasPoint) extra++;
+        if (lower == 'g') {
+            int wanted = (precision < 0) ? 6 : std::max(precision, 1);
+            int significant = 0;
+            bool leading = true;
+            for (int i = 0; i < mantissa; i++) {
+                if (digits[i] == '.') continue;
+                if (leading && digits[i] == '0') continue;
+                leading = false;
+                significant++;
+            }
+            if (leading) significant = 1;   // the value is zero
+            extra += std::max(wanted - significant, 0);
+        }
+        if (extra == 0) return len;
+        if (len + extra > capacity) return -1;
+        
+        std::memmove(digits + mantissa + extra, digits + mantissa, len - mantissa);
+        int pos = mantissa;
+        if (!hasPoint) digits[pos++] = '.';
+        while (pos < mantissa + extra) digits[pos++] = '0';
+        return len + extra;
+    }
+    
+    static inline void FormatFloat(FormatCursor& out, const FormatSpec& spec, double value) {
+        char digits[352];
+        char lower = (char)(spec.conversion | 0x20);
+        bool upper = spec.conversion != lower;
+        bool negative = std::signbit(value);
+        double magnitude = negative ? -value : value;
+        
+        int len;
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+        std::chars_format format = (lower == 'f') ? std::chars_format::fixed
+                                 : (lower == 'e') ? std::chars_format::scientific
+                                 : (lower == 'a') ? std::chars_format::hex
+                                 :                  std::chars_format::general;
+        std::to_chars_result result = (lower == 'a' && spec.precision < 0)
+            ? std::to_chars(digits, digits + sizeof(digits), magnitude, format)
+            : std::to_chars(digits, digits + sizeof(digits), magnitude, format,
+                            spec.precision < 0 ? 6 : spec.precision);
+        len = (result.ec == std::errc()) ? (int)(result.ptr - digits) : -1;
+#else
+        // Library without floating-point to_chars: format the magnitude on the stack
+        char conv[8] = {'%', '.', '*', lower, 0};
+        len = std::snprintf(digits, sizeof(digits), conv, spec.precision < 0 ? 6 : spec.precision, magnitude);
+        if (len >= (int)sizeof(digits)) len = -1;
+#endif
+        if (len >= 0 && spec.alternate && std::isfinite(value)) {
+            len = ForceDecimalPoint(digits, len, (int)sizeof(digits), lower, spec.precision);
+        }
+        if (len < 0) {
+            RING_LOG("FormatInto: '%%%c' field exceeds %d bytes", spec.conversion, (int)sizeof(digits));
+            out.failed = true;
+            return;
+        }
+        if (upper) {
+            for (int i = 0; i < len; i++) {
+                if (digits[i] >= 'a' && digits[i] <= 'z') digits[i] -= 'a' - 'A';
+            }
+        }
+        
+        char prefix[3];
+        int prefixLen = 0;
+        if (negative) prefix[prefixLen++] = '-';
+        else if (spec.sign) prefix[prefixLen++] = spec.sign;
+        if (lower == 'a') {
+            prefix[prefixLen++] = '0';
+            prefix[prefixLen++] = upper ? 'X' : 'x';
+        }
+        
+        FormatSpec padSpec = spec;
+        if (!std::isfinite(value)) padSpec.zeroPad = false;
+        PutPadded(out, padSpec, prefix, prefixLen, digits, len);
+    }
+    
+    static inline void FormatArg(FormatCursor& out, const FormatSpec& spec, va_list& args) {
+        switch (spec.conversion) {
+            case 'd': case 'i': {
+                long long value;
+                switch (spec.length) {
+                    case 'H': value = (signed char)va_arg(args, int); break;
+                    case 'h': value = (short)va_arg(args, int); break;
+                    case 'l': value = va_arg(args, long); break;
+                    case 'L': value = va_arg(args, long long); break;
+                    case 'j': value = va_arg(args, intmax_t); break;
+                    case 'z': value = (long long)va_arg(args, size_t); break;
+                    case 't': value = va_arg(args, ptrdiff_t); break;
+                    default:  value = va_arg(args, int); break;
+                }
+                unsigned long long magnitude = (value < 0) ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+                FormatInteger(out, spec, magnitude, value < 0, 10, false);
+                break;
+            }
+            case 'u': case 'o': case 'x': case 'X': {
+                unsigned long long value;
+                switch (spec.length) {
+                    case 'H': value = (unsigned char)va_arg(args, unsigned int); break;
+                    case 'h': value = (unsigned short)va_arg(args, unsigned int); break;
+                    case 'l': value = va_arg(args, unsigned long); break;
+                    case 'L': value = va_arg(args, unsigned long long); break;
+                    case 'j': value = va_arg(args, uintmax_t); break;
+                    case 'z': value = va_arg(args, size_t); break;
+                    case 't': value = (unsigned long long)va_arg(args, ptrdiff_t); break;
+                    default:  value = va_arg(args, unsigned int); break;
+                }
+                int base = (spec.conversion == 'u') ? 10 : (spec.conversion == 'o') ? 8 : 16;
+                FormatInteger(out, spec, value, false, base, spec.conversion == 'X');
+                break;
+            }
+            case 'p': {
+                char digits[24];
+                uintptr_t value = (uintptr_t)va_arg(args, void*);
+                int len = (int)(std::to_chars(digits, digits + sizeof(digits), (unsigned long long)value, 16).ptr - digits);
+                PutPadded(out, spec, "0x", 2, digits, len);
+                break;
+            }
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A': {
+                // long double would be narrowed to double; refuse rather than lose digits
+                if (spec.length == 'D') return FormatUnsupported(out, spec);
+                double value = va_arg(args, double);
+                FormatFloat(out, spec, value);
+                break;
+            }
+            case 'c': {
+                if (spec.length) return FormatUnsupported(out, spec);
+                char c = (char)va_arg(args, int);
+                FormatSpec padSpec = spec;
+                padSpec.zeroPad = false;
+                PutPadded(out, padSpec, nullptr, 0, &c, 1);
+                break;
+            }
+            case 's': {
+                if (spec.length) return FormatUnsupported(out, spec);
+                const char* str = va_arg(args, const char*);
+                if (!str) str = "(null)";
+                int len = 0;
+                while (str[len] && (spec.precision < 0 || len < spec.precision)) len++;
+                FormatSpec padSpec = spec;
+                padSpec.zeroPad = false;
+                PutPadded(out, padSpec, nullptr, 0, str, len);
+                break;
+            }
+            case '%':
+                out.Put("%", 1);
+                break;
+            default:
+                // The argument can't be skipped safely without knowing its type, so stop here
+                FormatUnsupported(out, spec);
+                break;
+        }
+    }
+    
+    static inline void FormatUnsupported(FormatCursor& out, [[maybe_unused]] const FormatSpec& spec) {
+        RING_LOG("FormatInto: unsupported conversion '%c'", spec.conversion ? spec.conversion : '?');
+        out.failed = true;
+    }
+    
+    // ===== BYTE-SWAP KERNELS =====
+    
+    template <int N>
+    static inline void SwapElement(uint8_t* dst, const uint8_t* src) {
+        if constexpr (RING_BIG_ENDIAN_HOST) {
+            std::memcpy(dst, src, N);
+        } else if constexpr (N == 2) {
+            uint16_t v; std::memcpy(&v, src, 2);
+            v = __builtin_bswap16(v);
+            std::memcpy(dst, &v, 2);
+        } else if constexpr (N == 4) {
+            uint32_t v; std::memcpy(&v, src, 4);
+            v = __builtin_bswap32(v);
+            std::memcpy(dst, &v, 4);
+        } else {
+            uint64_t v; std::memcpy(&v, src, 8);
+            v = __builtin_bswap64(v);
+            std::memcpy(dst, &v, 8);
+        }
+    }
+    
+    // Copies `count` N-byte elements reversing the byte order of each one.
+    // dst and src must not overlap; neither needs to be aligned.
+    template <int N>
+    static inline void SwapCopy(uint8_t* dst, const uint8_t* src, int count) {
+#if RING_BIG_ENDIAN_HOST
+        std::memcpy(dst, src, (size_t)count * N);
+#else
+        int i = 0;
+        const int bytes = count * N;
+#if defined(__AVX2__) || defined(__SSSE3__)
+        // pshufb mask reversing every N-byte lane of a 16-byte block
+        const __m128i mask = (N == 2) ? _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14)
+                           : (N == 4) ? _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12)
+                           :            _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+#if defined(__AVX2__)
+        const __m256i mask256 = _mm256_broadcastsi128_si256(mask);
+        for (; i + 64 <= bytes; i += 64) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 32));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_shuffle_epi8(a, mask256));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 32), _mm256_shuffle_epi8(b, mask256));
+        }
+        for (; i + 32 <= bytes; i += 32) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_shuffle_epi8(a, mask256));
+        }
+#endif
+        for (; i + 16 <= bytes; i += 16) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_shuffle_epi8(a, mask));
+        }
+#elif defined(__SSE2__) || defined(_M_X64)
+        // No pshufb: reorder 16-bit words within each element, then swap
+        // the bytes of every word
+        for (; i + 16 <= bytes; i += 16) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            if constexpr (N == 4) {
+                a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(a, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+            } else if constexpr (N == 8) {
+                a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(a, _MM_SHUFFLE(0, 1, 2, 3)), _MM_SHUFFLE(0, 1, 2, 3));
+            }
+            a = _mm_or_si128(_mm_slli_epi16(a, 8), _mm_srli_epi16(a, 8));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), a);
+        }
+#elif defined(__ARM_NEON)
+        for (; i + 16 <= bytes; i += 16) {
+            uint8x16_t a = vld1q_u8(src + i);
+            if constexpr (N == 2)      a = vrev16q_u8(a);
+            else if constexpr (N == 4) a = vrev32q_u8(a);
+            else                       a = vrev64q_u8(a);
+            vst1q_u8(dst + i, a);
+        }
+#endif
+        for (; i < bytes; i += N) {
+            SwapElement<N>(dst + i, src + i);
+        }
+#endif
+    }
+    
+    // Writes `bytes` (a multiple of N) from host-order src into the ring at
+    // pos, storing each element big-endian. Handles an element that
+    // straddles the wrap point.
+    template <int N>
+    inline void SwapIntoRing(int pos, const uint8_t* src, int bytes) {
+        int firstPart = mBufSize - pos;
+        if (bytes <= firstPart) {
+            SwapCopy<N>(&mBuffer[pos], src, bytes / N);
+            return;
+        }
+        int whole = firstPart / N;
+        int split = firstPart % N;
+        SwapCopy<N>(&mBuffer[pos], src, whole);
+        src += whole * N;
+        bytes -= whole * N;
+        
+        int wrapPos = 0;
+        if (split) {
+            uint8_t tmp[N];
+            SwapElement<N>(tmp, src);
+            std::memcpy(&mBuffer[pos + whole * N], tmp, split);
+            std::memcpy(&mBuffer[0], tmp + split, N - split);
+            src += N;
+            bytes -= N;
+            wrapPos = N - split;
+        }
+        SwapCopy<N>(&mBuffer[wrapPos], src, bytes / N);
+    }
+    
+    // Reads `bytes` (a multiple of N) of big-endian elements from the ring
+    // at pos into host-order dst.
+    template <int N>
+    inline void SwapFromRing(uint8_t* dst, int pos, int bytes) const {
+        int firstPart = mBufSize - pos;
+        if (bytes <= firstPart) {
+            SwapCopy<N>(dst, &mBuffer[pos], bytes / N);
+            return;
+        }
+        int whole = firstPart / N;
+        int split = firstPart % N;
+        SwapCopy<N>(dst, &mBuffer[pos], whole);
+        dst += whole * N;
+        bytes -= whole * N;
+        
+        int wrapPos = 0;
+        if (split) {
+            uint8_t tmp[N];
+            std::memcpy(tmp, &mBuffer[pos + whole * N], split);
+            std::memcpy(tmp + split, &mBuffer[0], N - split);
+            SwapElement<N>(dst, tmp);
+            dst += N;
+            bytes -= N;
+            wrapPos = N - split;
+        }
+        SwapCopy<N>(dst, &mBuffer[wrapPos], bytes / N);
+    }
+    
+public:
     RingBuffer(const RingBuffer&) = delete;
     RingBuffer& operator=(const RingBuffer&) = delete;
     RingBuffer(RingBuffer&& other) noexcept = delete;
@@ -0,0 +1,114 @@
+/*
+ *   The Ultimate Ring Buffer v1.2 - Channel Demultiplexer
+ *   �1999-2025 SUBBAND, Inc. & Dmitry Boldyrev
+ *   
+ *   Description:    Routes framed records from one RingBuffer into per-channel sub-rings
+ *   Updated:        Oct 18, 2026
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "ringbuffer.h"
+
+// Reads framed records (RingBuffer::WriteRecord with a channel id) from a
+// shared transport ring once and moves each into its channel's sub-ring with
+// a single ring-to-ring copy. Backpressure is per channel: when a sub-ring is
+// full its record is dropped and counted and the channel is flagged as
+// backpressured, so one slow consumer never blocks the head of the shared
+// ring. Records for channels that were never opened are discarded.
+//
+// Pump() runs on the source ring's consumer thread and is the producer of
+// every sub-ring; each channel is then drained by its own consumer through
+// the usual ReadRecord(). Counters may be read from any thread.
+
+class RingDemux {
+public:
+    static constexpr int kChannels = 256;
+    
+    explicit RingDemux(RingBuffer& source) : mSource(source) {}
+    
+    // Opens (or resizes) a channel's sub-ring; call before pumping starts
+    inline int OpenChannel(uint8_t channel, int size) {
+        try {
+            mChannels[channel].ring = std::make_unique<RingBuffer>(size);
+        } catch (const std::exception&) {
+            RING_LOG("RingDemux: failed to open channel %d (%d bytes)", channel, size);
+            return -1;
+        }
+        return 0;
+    }
+    
+    inline RingBuffer* _Nullable Channel(uint8_t channel) const {
+        return mChannels[channel].ring.get();
+    }
+    
+    // Routes up to maxRecords records; returns the number delivered
+    inline int Pump(int maxRecords = INT32_MAX) {
+        int delivered = 0;
+        RingBuffer::RecordHeader header;
+        
+        for (int i = 0; i < maxRecords && mSource.PeekRecordHeader(header); i++) {
+            ChannelState& state = mChannels[header.channel];
+            
+            if (!state.ring) {
+                mSource.SkipRecord();
+                Bump(mUnrouted);
+                continue;
+            }
+            
+            if (mSource.ForwardRecord(*state.ring) < 0) {
+                mSource.SkipRecord();
+                Bump(state.dropped);
+                state.backpressured.store(true, std::memory_order_relaxed);
+                RING_LOG("RingDemux: channel %d full, dropped %u bytes", header.channel, header.size);
+                continue;
+            }
+            
+            Bump(state.routed);
+            state.backpressured.store(false, std::memory_order_relaxed);
+            delivered++;
+        }
+        return delivered;
+    }
+    
+    // ===== PER-CHANNEL METRICS =====
+    
+    inline uint64_t Routed(uint8_t channel) const {
+        return mChannels[channel].routed.load(std::memory_order_relaxed);
+    }
+    
+    inline uint64_t Dropped(uint8_t channel) const {
+        return mChannels[channel].dropped.load(std::memory_order_relaxed);
+    }
+    
+    // True while the channel's last record found its sub-ring full
+    inline bool Backpressured(uint8_t channel) const {
+        return mChannels[channel].backpressured.load(std::memory_order_relaxed);
+    }
+    
+    inline uint64_t Unrouted() const {
+        return mUnrouted.load(std::memory_order_relaxed);
+    }
+    
+    RingDemux(const RingDemux&) = delete;
+    RingDemux& operator=(const RingDemux&) = delete;
+    
+private:
+    struct ChannelState {
+        std::unique_ptr<RingBuffer> ring;
+        std::atomic<uint64_t> routed{0};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<bool> backpressured{false};
+    };
+    
+    // Single writer (the pump thread)
+    static inline void Bump(std::atomic<uint64_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    
+    RingBuffer& mSource;
+    ChannelState mChannels[kChannels];
+    std::atomic<uint64_t> mUnrouted{0};
+};
@@ -0,0 +1,260 @@
+/*
+ *   The Ultimate Ring Buffer v1.2 - In-Place Messages
+ *   �1999-2025 SUBBAND, Inc. & Dmitry Boldyrev
+ *   
+ *   Description:    Zero-copy flat message builder/view over RingBuffer records
+ *   Updated:        Oct 18, 2026
+ */
+
+#pragma once
+
+#include <string_view>
+#include <type_traits>
+
+#include "ringbuffer.h"
+
+// Flat, offset-based message layout, built directly inside a reserved
+// RingBuffer record and read back in place:
+//
+//     MessageHeader   { size, fieldCount }
+//     uint32_t        fieldOffset[fieldCount]     // 0 = field absent
+//     data...                                     // scalars, strings, arrays
+//
+// Offsets are relative to the start of the message, so the layout survives
+// GrowRecord() relocating it. Strings and arrays are stored as a uint32_t
+// count immediately followed by the elements; the count is placed so the
+// elements land on alignof(T). Values (and array elements) are naturally
+// aligned relative to the message start only; the view copies scalars out
+// with memcpy, so no alignment is assumed of ring memory.
+
+struct RingMessageHeader {
+    uint32_t size;          // total message bytes
+    uint16_t fieldCount;
+    uint16_t reserved;
+};
+
+// ===== MESSAGE BUILDER =====
+
+class RingMessageBuilder {
+public:
+    RingMessageBuilder(RingBuffer& ring, int fieldCount, int sizeHint = 256, uint8_t channel = 0)
+        : mRing(ring), mFieldCount(fieldCount) {
+        int tableBytes = (int)sizeof(RingMessageHeader) + fieldCount * (int)sizeof(uint32_t);
+        if (fieldCount < 0 || fieldCount > UINT16_MAX) return;
+        
+        mCapacity = std::max(sizeHint, tableBytes);
+        mData = mRing.BeginRecord(mCapacity, channel);
+        if (!mData) return;
+        
+        std::memset(mData, 0, tableBytes);
+        mUsed = tableBytes;
+    }
+    
+    ~RingMessageBuilder() {
+        if (mData) mRing.CancelRecord();
+    }
+    
+    inline bool Ok() const {
+        return mData != nullptr;
+    }
+    
+    template <typename T>
+    inline bool Set(int field, const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "message fields must be trivially copyable");
+        if (!ValidField(field)) return false;
+        int offset = Append(&value, (int)sizeof(T), (int)alignof(T));
+        return offset > 0 && SetOffset(field, offset);
+    }
+    
+    template <typename T>
+    inline bool SetArray(int field, const T* _Nullable items, int count) {
+        static_assert(std::is_trivially_copyable<T>::value, "message fields must be trivially copyable");
+        if (!ValidField(field) || count < 0 || (count > 0 && !items)) return false;
+        
+        // The count goes just before the next alignof(T) boundary so the
+        // elements that follow it are aligned
+        uint32_t n = (uint32_t)count;
+        int offset = Append(&n, (int)sizeof(n), (int)std::max(alignof(T), alignof(uint32_t)), (int)sizeof(n));
+        if (offset <= 0 || (count > 0 && Append(items, count * (int)sizeof(T), 1) <= 0)) return false;
+        return SetOffset(field, offset);
+    }
+    
+    inline bool SetString(int field, std::string_view str) {
+        return SetArray(field, str.data(), (int)str.size());
+    }
+    
+    // Publishes the message; returns its size, or -1 if building failed
+    inline int Finish() {
+        if (!mData) return -1;
+        
+        RingMessageHeader header{(uint32_t)mUsed, (uint16_t)mFieldCount, 0};
+        std::memcpy(mData, &header, sizeof(header));
+        
+        int bytes = mRing.CommitRecord(mUsed);
+        mData = nullptr;
+        return bytes;
+    }
+    
+    inline int Size() const {
+        return mUsed;
+    }
+    
+    RingMessageBuilder(const RingMessageBuilder&) = delete;
+    RingMessageBuilder& operator=(const RingMessageBuilder&) = delete;
+    
+private:
+    inline bool ValidField(int field) const {
+        return field >= 0 && field < mFieldCount;
+    }
+    
+    inline bool SetOffset(int field, int offset) {
+        if (!ValidField(field)) return false;
+        
+        uint32_t value = (uint32_t)offset;
+        std::memcpy(mData + sizeof(RingMessageHeader) + field * sizeof(uint32_t), &value, sizeof(value));
+        return true;
+    }
+    
+    // Appends bytes so that offset + lead is a multiple of align; returns
+    // their message offset (always > 0), or -1 if the reservation could not grow
+    inline int Append(const void* src, int bytes, int align, int lead = 0) {
+        if (!mData) return -1;
+        
+        int offset = ((mUsed + lead + align - 1) & ~(align - 1)) - lead;
+        int needed = offset + bytes;
+        if (needed > mCapacity) {
+            int capacity = std::max(needed, mCapacity * 2);
+            uint8_t* data = mRing.GrowRecord(capacity);
+            if (!data && capacity > needed) {
+                capacity = needed;
+                data = mRing.GrowRecord(capacity);
+            }
+            if (!data) {
+                RING_LOG("RingMessageBuilder: cannot grow to %d bytes", needed);
+                return -1;
+            }
+            mData = data;
+            mCapacity = capacity;
+        }
+        
+        std::memset(mData + mUsed, 0, offset - mUsed);
+        std::memcpy(mData + offset, src, bytes);
+        mUsed = needed;
+        return offset;
+    }
+    
+    RingBuffer& mRing;
+    uint8_t* _Nullable mData{nullptr};
+    int mFieldCount{0};
+    int mCapacity{0};
+    int mUsed{0};
+};
+
+// ===== MESSAGE VIEW =====
+
+// Unaligned-safe view of an array field
+template <typename T>
+class RingArrayView {
+public:
+    RingArrayView() = default;
+    RingArrayView(const uint8_t* _Nullable data, int count) : mData(data), mCount(count) {}
+    
+    inline int size() const { return mCount; }
+    inline bool empty() const { return mCount == 0; }
+    inline const uint8_t* _Nullable bytes() const { return mData; }
+    
+    inline T operator[](int index) const {
+        T value;
+        std::memcpy(&value, mData + (size_t)index * sizeof(T), sizeof(T));
+        return value;
+    }
+    
+private:
+    const uint8_t* _Nullable mData{nullptr};
+    int mCount{0};
+};
+
+// Read-only accessor over a message in place, e.g. on the consumer side:
+//
+//     RingBuffer::RecordHeader header;
+//     if (const uint8_t* data = ring.PeekRecordView(header)) {
+//         RingMessageView msg(data, header.size);
+//         ... msg.Get<int32_t>(0), msg.GetString(1) ...
+//         ring.SkipRecord();
+//     }
+//
+// Every access is bounds-checked against the record size; a missing or
+// malformed field reads as the default value / an empty view.
+
+class RingMessageView {
+public:
+    RingMessageView(const uint8_t* _Nullable data, int bytes) : mData(data), mBytes(bytes) {
+        if (!mData || mBytes < (int)sizeof(RingMessageHeader)) {
+            mData = nullptr;
+            return;
+        }
+        RingMessageHeader header;
+        std::memcpy(&header, mData, sizeof(header));
+        int tableBytes = (int)sizeof(RingMessageHeader) + header.fieldCount * (int)sizeof(uint32_t);
+        if ((int)header.size > mBytes || tableBytes > (int)header.size) {
+            mData = nullptr;
+            return;
+        }
+        mBytes = (int)header.size;
+        mFieldCount = header.fieldCount;
+    }
+    
+    inline bool Valid() const {
+        return mData != nullptr;
+    }
+    
+    inline int FieldCount() const {
+        return mFieldCount;
+    }
+    
+    inline bool Has(int field) const {
+        return FieldOffset(field) != 0;
+    }
+    
+    template <typename T>
+    inline T Get(int field, T defaultValue = T{}) const {
+        static_assert(std::is_trivially_copyable<T>::value, "message fields must be trivially copyable");
+        uint32_t offset = FieldOffset(field);
+        if (!offset || offset + sizeof(T) > (uint32_t)mBytes) return defaultValue;
+        
+        T value;
+        std::memcpy(&value, mData + offset, sizeof(T));
+        return value;
+    }
+    
+    template <typename T>
+    inline RingArrayView<T> GetArray(int field) const {
+        uint32_t offset = FieldOffset(field);
+        if (!offset || offset + sizeof(uint32_t) > (uint32_t)mBytes) return {};
+        
+        uint32_t count;
+        std::memcpy(&count, mData + offset, sizeof(count));
+        uint64_t end = (uint64_t)offset + sizeof(uint32_t) + (uint64_t)count * sizeof(T);
+        if (end > (uint64_t)mBytes) return {};
+        return RingArrayView<T>(mData + offset + sizeof(uint32_t), (int)count);
+    }
+    
+    inline std::string_view GetString(int field) const {
+        RingArrayView<char> chars = GetArray<char>(field);
+        if (chars.empty()) return {};
+        return std::string_view(reinterpret_cast<const char*>(chars.bytes()), (size_t)chars.size());
+    }
+    
+private:
+    inline uint32_t FieldOffset(int field) const {
+        if (!mData || field < 0 || field >= mFieldCount) return 0;
+        
+        uint32_t offset;
+        std::memcpy(&offset, mData + sizeof(RingMessageHeader) + field * sizeof(uint32_t), sizeof(offset));
+        return (offset < (uint32_t)mBytes) ? offset : 0;
+    }
+    
+    const uint8_t* _Nullable mData{nullptr};
+    int mBytes{0};
+    int mFieldCount{0};
+};
@@ -0,0 +1,228 @@
+/*
+ *   The Ultimate Ring Buffer v1.2 - Overlapped Block Reader/Writer
+ *   �1999-2025 SUBBAND, Inc. & Dmitry Boldyrev
+ *   
+ *   Description:    Hop-advancing windowed reads and overlap-add writes over AudioRing
+ *   Updated:        Oct 18, 2026
+ */
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include "audioring.h"
+
+// Block DSP framing for STFT-style processors: the analysis side sees a
+// window of N frames that advances by a hop of H <= N, the synthesis side
+// overlap-adds N-frame blocks and releases H finished frames per block.
+//
+// HopReader keeps each channel in mirrored storage of 2N samples, so every
+// new frame is written twice and the current window is always one
+// contiguous run; advancing costs H frames of copying instead of N. The
+// analysis window is applied on the way out by ReadWindowed(), or View()
+// exposes the raw window without copying.
+//
+// OverlapAddWriter accumulates into a circular N-frame buffer per channel,
+// applying the synthesis window in the same pass, scaled so the analysis x
+// synthesis product overlaps to unity on average. Reconstruction is exact
+// when that product is COLA at the hop: N/2 for SqrtHann pairs, N/4 (or any
+// N/k, k >= 3) for Hann pairs.
+//
+// Both are planar (one array per channel) and work on the ring's consumer
+// (HopReader) or producer (OverlapAddWriter) thread.
+
+enum class WindowShape { Rectangular, Hann, SqrtHann };
+
+// Periodic windows, so hops that divide N overlap-add to a constant
+static inline void FillWindow(float* _Nonnull window, int frames, WindowShape shape) {
+    for (int i = 0; i < frames; i++) {
+        double hann = 0.5 - 0.5 * std::cos(2.0 * kRingPi * i / frames);
+        switch (shape) {
+            case WindowShape::Rectangular: window[i] = 1.0f; break;
+            case WindowShape::Hann:        window[i] = (float)hann; break;
+            case WindowShape::SqrtHann:    window[i] = (float)std::sqrt(hann); break;
+        }
+    }
+}
+
+class HopReader {
+public:
+    HopReader(AudioRing<float>& ring, int windowFrames, int hopFrames, WindowShape shape = WindowShape::Hann) : mRing(ring) {
+        if (Init(windowFrames, hopFrames, shape) < 0) {
+            throw std::runtime_error("HopReader initialization failed");
+        }
+    }
+    
+    inline int Init(int windowFrames, int hopFrames, WindowShape shape) {
+        if (windowFrames <= 0 || hopFrames <= 0 || hopFrames > windowFrames) return -1;
+        
+        mChannels = mRing.Channels();
+        mFrames = windowFrames;
+        mHop = hopFrames;
+        try {
+            mMirror.assign((size_t)mChannels * 2 * mFrames, 0.0f);
+            mWindow.assign((size_t)mFrames, 0.0f);
+            mChannelPtrs.assign((size_t)mChannels, nullptr);
+        } catch (const std::bad_alloc&) {
+            RING_LOG("HopReader: allocation failed for %d x %d", windowFrames, mChannels);
+            return -1;
+        }
+        FillWindow(mWindow.data(), mFrames, shape);
+        mPos = 0;
+        mPrimed = false;
+        return 0;
+    }
+    
+    // Pulls the next hop (the whole first window) from the ring. Returns 1
+    // when a new window is ready, 0 if the ring doesn't hold enough frames yet.
+    inline int Advance() {
+        int needed = mPrimed ? mHop : mFrames;
+        if (mRing.UsedFrames() < needed) return 0;
+        
+        Append(needed);
+        mPrimed = true;
+        return 1;
+    }
+    
+    // The current window for `channel`: WindowFrames() contiguous samples,
+    // oldest first, valid until the next Advance()
+    inline const float* View(int channel) const {
+        return &mMirror[(size_t)channel * 2 * mFrames + mPos];
+    }
+    
+    // Copies the current window with the analysis window applied;
+    // out[c] receives WindowFrames() samples
+    inline void ReadWindowed(float* _Nonnull const* _Nonnull out) const {
+        for (int c = 0; c < mChannels; c++) {
+            AudioKernels::Multiply(out[c], View(c), mWindow.data(), mFrames);
+        }
+    }
+    
+    inline int WindowFrames() const { return mFrames; }
+    inline int HopFrames() const { return mHop; }
+    inline const float* Window() const { return mWindow.data(); }
+    
+    HopReader(const HopReader&) = delete;
+    HopReader& operator=(const HopReader&) = delete;
+    
+private:
+    // Reads `count` frames into both halves of the mirror after the window
+    inline void Append(int count) {
+        int first = std::min(count, mFrames - mPos);
+        ReadRun(mPos, first);
+        if (count > first) {
+            ReadRun(0, count - first);
+        }
+        mPos = (mPos + count) % mFrames;
+    }
+    
+    inline void ReadRun(int pos, int count) {
+        for (int c = 0; c < mChannels; c++) {
+            mChannelPtrs[c] = &mMirror[(size_t)c * 2 * mFrames + pos];
+        }
+        mRing.ReadPlanar(mChannelPtrs.data(), count);
+        for (int c = 0; c < mChannels; c++) {
+            std::memcpy(mChannelPtrs[c] + mFrames, mChannelPtrs[c], (size_t)count * sizeof(float));
+        }
+    }
+    
+    AudioRing<float>& mRing;
+    int mChannels{0};
+    int mFrames{0};
+    int mHop{0};
+    int mPos{0};                        // start of the current window in the mirror
+    bool mPrimed{false};
+    std::vector<float> mMirror;         // per channel: 2 * mFrames, second half mirrors the first
+    std::vector<float> mWindow;
+    std::vector<float*> mChannelPtrs;
+};
+
+class OverlapAddWriter {
+public:
+    OverlapAddWriter(AudioRing<float>& ring, int windowFrames, int hopFrames,
+                     WindowShape synthesis = WindowShape::Hann, WindowShape analysis = WindowShape::Hann) : mRing(ring) {
+        if (Init(windowFrames, hopFrames, synthesis, analysis) < 0) {
+            throw std::runtime_error("OverlapAddWriter initialization failed");
+        }
+    }
+    
+    inline int Init(int windowFrames, int hopFrames, WindowShape synthesis, WindowShape analysis) {
+        if (windowFrames <= 0 || hopFrames <= 0 || hopFrames > windowFrames) return -1;
+        
+        mChannels = mRing.Channels();
+        mFrames = windowFrames;
+        mHop = hopFrames;
+        try {
+            mAccum.assign((size_t)mChannels * mFrames, 0.0f);
+            mWindow.assign((size_t)mFrames, 0.0f);
+            mChannelPtrs.assign((size_t)mChannels, nullptr);
+        } catch (const std::bad_alloc&) {
+            RING_LOG("OverlapAddWriter: allocation failed for %d x %d", windowFrames, mChannels);
+            return -1;
+        }
+        
+        // Scale so the analysis x synthesis product overlaps to unity
+        std::vector<float> analysisWindow((size_t)mFrames);
+        FillWindow(analysisWindow.data(), mFrames, analysis);
+        FillWindow(mWindow.data(), mFrames, synthesis);
+        double overlap = 0.0;
+        for (int i = 0; i < mFrames; i++) {
+            overlap += (double)analysisWindow[i] * mWindow[i];
+        }
+        float scale = overlap > 0.0 ? (float)(mHop / overlap) : 1.0f;
+        for (float& w : mWindow) w *= scale;
+        
+        mPos = 0;
+        return 0;
+    }
+    
+    // Overlap-adds one block (block[c] holds WindowFrames() samples) and
+    // writes the HopFrames() frames it completes. Returns the frames
+    // written, or -1 if the ring can't take a hop (nothing is consumed).
+    inline int Write(const float* _Nonnull const* _Nonnull block) {
+        if (mRing.FreeFrames() < mHop) return -1;
+        
+        int first = mFrames - mPos;
+        for (int c = 0; c < mChannels; c++) {
+            float* accum = &mAccum[(size_t)c * mFrames];
+            AudioKernels::MultiplyAccumulate(accum + mPos, block[c], mWindow.data(), first);
+            AudioKernels::MultiplyAccumulate(accum, block[c] + first, mWindow.data() + first, mPos);
+        }
+        
+        int run = std::min(mHop, mFrames - mPos);
+        WriteRun(mPos, run);
+        if (mHop > run) {
+            WriteRun(0, mHop - run);
+        }
+        mPos = (mPos + mHop) % mFrames;
+        return mHop;
+    }
+    
+    inline int WindowFrames() const { return mFrames; }
+    inline int HopFrames() const { return mHop; }
+    
+    OverlapAddWriter(const OverlapAddWriter&) = delete;
+    OverlapAddWriter& operator=(const OverlapAddWriter&) = delete;
+    
+private:
+    // Emits a finished run of the accumulator and clears it for reuse
+    inline void WriteRun(int pos, int count) {
+        for (int c = 0; c < mChannels; c++) {
+            mChannelPtrs[c] = &mAccum[(size_t)c * mFrames + pos];
+        }
+        mRing.WritePlanar(mChannelPtrs.data(), count);
+        for (int c = 0; c < mChannels; c++) {
+            std::fill_n(mChannelPtrs[c], count, 0.0f);
+        }
+    }
+    
+    AudioRing<float>& mRing;
+    int mChannels{0};
+    int mFrames{0};
+    int mHop{0};
+    int mPos{0};                        // accumulator index of the oldest pending frame
+    std::vector<float> mAccum;          // per channel: circular, mFrames
+    std::vector<float> mWindow;         // normalised synthesis window
+    std::vector<float*> mChannelPtrs;
+};
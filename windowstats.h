@@ -0,0 +1,218 @@
+/*
+ *   The Ultimate Ring Buffer v1.2 - Sliding Window Statistics
+ *   �1999-2025 SUBBAND, Inc. & Dmitry Boldyrev
+ *   
+ *   Description:    Incremental per-channel min/max/mean/RMS over the last N frames written
+ *   Updated:        Oct 18, 2026
+ */
+
+#pragma once
+
+#include <cmath>
+#include <memory>
+
+#include "audiokernels.h"
+
+// Statistics over the most recent N frames of a stream, updated as frames
+// are pushed and readable in O(1). Min and max come from monotonic deques
+// (each frame enters and leaves a deque once); mean and RMS from running
+// sums, recomputed exactly from the retained window every N frames so
+// rounding drift can't accumulate.
+//
+// The window keeps its own copy of the last N frames, so it is independent
+// of what the ring's consumer has already taken. Push() is producer only;
+// Read() may be called from any thread and sees a consistent per-channel
+// snapshot (seqlock) published at the end of each Push().
+
+class WindowStats {
+public:
+    struct Snapshot {
+        float min;
+        float max;
+        float mean;
+        float rms;
+        int frames;     // frames in the window so far, up to WindowFrames()
+    };
+    
+    WindowStats(int channels, int windowFrames) {
+        if (Init(channels, windowFrames) < 0) {
+            throw std::runtime_error("WindowStats initialization failed");
+        }
+    }
+    
+    inline int Init(int channels, int windowFrames) {
+        if (channels <= 0 || windowFrames <= 0) return -1;
+        try {
+            size_t samples = (size_t)channels * windowFrames;
+            mHistory.reset(new float[samples]());
+            mMaxDeque.reset(new Entry[samples]);
+            mMinDeque.reset(new Entry[samples]);
+            mChannelState.reset(new ChannelState[channels]);
+            mPublished.reset(new std::atomic<float>[(size_t)channels * kFields]);
+        } catch (const std::bad_alloc&) {
+            RING_LOG("WindowStats: allocation failed for %d x %d", windowFrames, channels);
+            return -1;
+        }
+        mChannels = channels;
+        mWindow = windowFrames;
+        Reset();
+        return 0;
+    }
+    
+    // Forgets all history; producer only
+    inline void Reset() {
+        std::fill_n(mHistory.get(), (size_t)mChannels * mWindow, 0.0f);
+        for (int c = 0; c < mChannels; c++) {
+            mChannelState[c] = ChannelState{};
+        }
+        mCount = 0;
+        mSinceResum = 0;
+        Publish();
+    }
+    
+    inline int Channels() const { return mChannels; }
+    inline int WindowFrames() const { return mWindow; }
+    
+    // Feeds interleaved frames; integer formats are normalised to [-1, 1)
+    template <typename SampleT>
+    inline void Push(const SampleT* _Nonnull data, int frames) {
+        for (int f = 0; f < frames; f++) {
+            int slot = (int)(mCount % (uint64_t)mWindow);
+            bool full = mCount >= (uint64_t)mWindow;
+            float* history = &mHistory[(size_t)slot * mChannels];
+            
+            for (int c = 0; c < mChannels; c++) {
+                float x = AudioKernels::LoadSample(data + (size_t)f * mChannels + c);
+                ChannelState& s = mChannelState[c];
+                float old = full ? history[c] : 0.0f;
+                s.sum += (double)x - old;
+                s.sumSquares += (double)x * x - (double)old * old;
+                history[c] = x;
+                
+                PushDeque(mMaxDeque.get(), c, s.maxHead, s.maxSize, x, [](float a, float b) { return a <= b; });
+                PushDeque(mMinDeque.get(), c, s.minHead, s.minSize, x, [](float a, float b) { return a >= b; });
+            }
+            mCount++;
+            
+            if (++mSinceResum >= mWindow) {
+                Resum();
+            }
+        }
+        Publish();
+    }
+    
+    // Consistent snapshot of one channel's window
+    inline Snapshot Read(int channel) const {
+        Snapshot snapshot;
+        const std::atomic<float>* fields = &mPublished[(size_t)channel * kFields];
+        for (;;) {
+            uint32_t before = mSequence.load(std::memory_order_acquire);
+            if (before & 1) continue;
+            snapshot.min = fields[0].load(std::memory_order_relaxed);
+            snapshot.max = fields[1].load(std::memory_order_relaxed);
+            snapshot.mean = fields[2].load(std::memory_order_relaxed);
+            snapshot.rms = fields[3].load(std::memory_order_relaxed);
+            snapshot.frames = mPublishedFrames.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (mSequence.load(std::memory_order_relaxed) == before) return snapshot;
+        }
+    }
+    
+    // Largest |sample| over the window across channels (meter / limiter peak)
+    inline float Peak() const {
+        float peak = 0.0f;
+        for (int c = 0; c < mChannels; c++) {
+            Snapshot s = Read(c);
+            peak = std::max(peak, std::max(std::fabs(s.min), std::fabs(s.max)));
+        }
+        return peak;
+    }
+    
+    WindowStats(const WindowStats&) = delete;
+    WindowStats& operator=(const WindowStats&) = delete;
+    
+private:
+    static constexpr int kFields = 4;
+    
+    struct Entry {
+        uint64_t index;
+        float value;
+    };
+    
+    // Per channel: running sums plus the circular deques' head and size
+    struct ChannelState {
+        double sum{0.0};
+        double sumSquares{0.0};
+        int maxHead{0};
+        int maxSize{0};
+        int minHead{0};
+        int minSize{0};
+    };
+    
+    // Deque storage is channel-major, mWindow entries per channel. Entries
+    // that `dominated(back, x)` says x supersedes are popped from the back,
+    // and the front expires once it falls out of the window.
+    template <typename Dominated>
+    inline void PushDeque(Entry* _Nonnull deque, int channel, int& head, int& size, float x, Dominated dominated) {
+        Entry* base = deque + (size_t)channel * mWindow;
+        while (size > 0 && dominated(base[(head + size - 1) % mWindow].value, x)) {
+            size--;
+        }
+        if (size > 0 && base[head].index + (uint64_t)mWindow <= mCount) {
+            head = (head + 1) % mWindow;
+            size--;
+        }
+        base[(head + size) % mWindow] = Entry{mCount, x};
+        size++;
+    }
+    
+    // Drift correction: exact sums over the retained window
+    inline void Resum() {
+        int frames = (int)std::min<uint64_t>(mCount, (uint64_t)mWindow);
+        for (int c = 0; c < mChannels; c++) {
+            double sum = 0.0;
+            double sumSquares = 0.0;
+            for (int f = 0; f < frames; f++) {
+                double x = mHistory[(size_t)f * mChannels + c];
+                sum += x;
+                sumSquares += x * x;
+            }
+            mChannelState[c].sum = sum;
+            mChannelState[c].sumSquares = sumSquares;
+        }
+        mSinceResum = 0;
+    }
+    
+    inline void Publish() {
+        int frames = (int)std::min<uint64_t>(mCount, (uint64_t)mWindow);
+        uint32_t sequence = mSequence.load(std::memory_order_relaxed);
+        mSequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        
+        for (int c = 0; c < mChannels; c++) {
+            const ChannelState& s = mChannelState[c];
+            std::atomic<float>* fields = &mPublished[(size_t)c * kFields];
+            const Entry* maxBase = &mMaxDeque[(size_t)c * mWindow];
+            const Entry* minBase = &mMinDeque[(size_t)c * mWindow];
+            fields[0].store(s.minSize ? minBase[s.minHead].value : 0.0f, std::memory_order_relaxed);
+            fields[1].store(s.maxSize ? maxBase[s.maxHead].value : 0.0f, std::memory_order_relaxed);
+            fields[2].store(frames ? (float)(s.sum / frames) : 0.0f, std::memory_order_relaxed);
+            fields[3].store(frames ? (float)std::sqrt(std::max(0.0, s.sumSquares) / frames) : 0.0f, std::memory_order_relaxed);
+        }
+        mPublishedFrames.store(frames, std::memory_order_relaxed);
+        mSequence.store(sequence + 2, std::memory_order_release);
+    }
+    
+    int mChannels{0};
+    int mWindow{0};
+    uint64_t mCount{0};                 // frames pushed since Reset()
+    int mSinceResum{0};
+    std::unique_ptr<float[]> mHistory;  // last mWindow frames, interleaved, slot = count % window
+    std::unique_ptr<Entry[]> mMaxDeque;
+    std::unique_ptr<Entry[]> mMinDeque;
+    std::unique_ptr<ChannelState[]> mChannelState;
+    
+    std::atomic<uint32_t> mSequence{0};
+    std::unique_ptr<std::atomic<float>[]> mPublished;   // min, max, mean, rms per channel
+    std::atomic<int> mPublishedFrames{0};
+};